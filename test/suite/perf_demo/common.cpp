@@ -20,6 +20,20 @@
 #include <flow/util/util.hpp>
 #include <flow/error/error.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+#include <boost/chrono/round.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <numeric>
+#include <cmath>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <unistd.h>
 
 /* These programs are doing some things that are counter-indicated for production server
  * applications; namely it is enforced that it is invoked from the dir where both session-server and -client apps
@@ -40,14 +54,41 @@ static const std::string S_EXEC_PRE_POSTFIX = "_shm_classic";
 const std::string SRV_NAME = "srv";
 const std::string CLI_NAME = "cli";
 
-// Universe of server apps: Just one.
-const ipc::session::Server_app::Master_set SRV_APPS
-        ({ { SRV_NAME,
-             { { SRV_NAME, WORK_DIR / (S_EXEC_PREFIX + SRV_NAME + S_EXEC_PRE_POSTFIX + S_EXEC_POSTFIX),
-                 ::geteuid(), ::getegid() },
-               { CLI_NAME }, // Allowed cli-apps that can open sessions.
-               WORK_DIR,
-               ipc::util::Permissions_level::S_GROUP_ACCESS } } });
+const std::string& transport_name(Transport transport)
+{
+  static const std::string S_NAMES[]
+    = { "socket", "socket_hndl", "posix_mq", "posix_mq_hndl", "bipc_mq", "bipc_mq_hndl" };
+  static_assert(std::size(S_NAMES) == size_t(Transport::S_END_SENTINEL), "One name per Transport please.");
+  return S_NAMES[size_t(transport)];
+}
+
+const std::string& transport_srv_name(Transport transport)
+{
+  // Must be legal App::m_name values: in particular no underscores.
+  static const std::string S_NAMES[]
+    = { SRV_NAME, "srvSocketHndl", "srvPosixMq", "srvPosixMqHndl", "srvBipcMq", "srvBipcMqHndl" };
+  static_assert(std::size(S_NAMES) == size_t(Transport::S_END_SENTINEL), "One name per Transport please.");
+  return S_NAMES[size_t(transport)];
+}
+
+/* Universe of server apps: Just one program; but it serves sessions of each Transport via a different
+ * Session_server, and each of those needs its own server app.  SRV_NAME is the S_SOCKET one; the one that matters
+ * for most benchmarks. */
+const ipc::session::Server_app::Master_set SRV_APPS = []()
+{
+  ipc::session::Server_app::Master_set srv_apps;
+  for (size_t idx = 0; idx != size_t(Transport::S_END_SENTINEL); ++idx)
+  {
+    const auto& name = transport_srv_name(Transport(idx));
+    srv_apps.insert({ name,
+                      { { name, WORK_DIR / (S_EXEC_PREFIX + SRV_NAME + S_EXEC_PRE_POSTFIX + S_EXEC_POSTFIX),
+                          ::geteuid(), ::getegid() },
+                        { CLI_NAME }, // Allowed cli-apps that can open sessions.
+                        WORK_DIR,
+                        ipc::util::Permissions_level::S_GROUP_ACCESS } });
+  }
+  return srv_apps;
+}();
 // Universe of client apps: Just one.
 const ipc::session::Client_app::Master_set CLI_APPS
         {
@@ -66,6 +107,46 @@ const ipc::session::Client_app::Master_set CLI_APPS
           }
         };
 
+bool pin_to_cpus(const Options& opts)
+{
+  if (opts.m_cpus.empty())
+  {
+    return true;
+  }
+  // else
+
+  /* This sets the calling thread's affinity; threads started after that inherit it.  Hence the must-be-first-thing
+   * requirement: then that's all of them.  (Processes we fork, like the multi-client benchmark's clients, do too.) */
+  ::cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (const auto cpu : opts.m_cpus)
+  {
+    CPU_SET(cpu, &cpu_set);
+  }
+  if (::sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0)
+  {
+    std::cerr << "Could not pin to CPUs [" << cpus_str(opts) << "]: "
+                 "[" << Error_code(errno, boost::system::system_category()) << "].\n";
+    return false;
+  }
+  return true;
+}
+
+std::string cpus_str(const Options& opts)
+{
+  if (opts.m_cpus.empty())
+  {
+    return "none";
+  }
+  // else
+  std::string str;
+  for (const auto cpu : opts.m_cpus)
+  {
+    str += (str.empty() ? "" : ",") + std::to_string(cpu);
+  }
+  return str;
+}
+
 void ensure_run_env(const char* argv0, bool srv_else_cli)
 {
   const auto exp_path = WORK_DIR /
@@ -79,9 +160,272 @@ void ensure_run_env(const char* argv0, bool srv_else_cli)
   }
 }
 
+Parse_result parse_options(Options* opts, int argc, char const * const * argv, bool srv_else_cli)
+{
+  namespace po = boost::program_options;
+  using std::cout;
+  using std::cerr;
+
+  std::string cpus_list_str;
+  std::string bench_str = "capnp";
+  std::string clients_str = "1,2,4,8";
+  std::string stl_elems_str = "1000,100000,1000000";
+  std::string transports_str = "socket,socket_hndl,posix_mq,posix_mq_hndl,bipc_mq,bipc_mq_hndl";
+  po::options_description opts_desc(srv_else_cli ? "perf_demo server options" : "perf_demo client options");
+  po::positional_options_description pos_desc;
+  opts_desc.add_options()
+    ("help,h", "print this message and exit")
+    ("log-file", po::value<std::string>(&opts->m_log_file),
+     "file for IPC/Flow logs (default: perf_demo_{srv|cli}.log)")
+    ("cpus", po::value<std::string>(&cpus_list_str),
+     "comma-separated CPUs to pin this process (all its threads) to (default: no pinning)")
+    ("spin-usec", po::value<unsigned int>(&opts->m_spin_usec)->default_value(opts->m_spin_usec),
+     "busy-poll the event loop for up to this long before blocking for anything to become ready (0: don't)");
+  if (srv_else_cli)
+  {
+    opts_desc.add_options()
+      ("size-mi", po::value<float>(&opts->m_total_sz_mi)->default_value(opts->m_total_sz_mi),
+       "rough capnp payload size (Mi) prepared at startup; used unless client requests others (e.g., --sweep)");
+    pos_desc.add("size-mi", 1).add("log-file", 1);
+  }
+  else
+  {
+    opts_desc.add_options()
+      ("sweep", po::bool_switch(&opts->m_sweep),
+       "sweep payload sizes (log-spaced) instead of one run at the server's startup size")
+      ("sweep-min", po::value<size_t>(&opts->m_sweep_min_sz)->default_value(opts->m_sweep_min_sz),
+       "smallest swept payload size (bytes)")
+      ("sweep-max", po::value<size_t>(&opts->m_sweep_max_sz)->default_value(opts->m_sweep_max_sz),
+       "largest swept payload size (bytes)")
+      ("sweep-sizes", po::value<unsigned int>(&opts->m_sweep_n_sizes)->default_value(opts->m_sweep_n_sizes),
+       "number of swept payload sizes")
+      ("warmup", po::value<unsigned int>(&opts->m_n_warmup),
+       "untimed iterations per benchmark before the timed ones (default: 0; with --sweep: 5)")
+      ("repeats", po::value<unsigned int>(&opts->m_n_repeats),
+       "timed iterations per benchmark (default: 1; with --sweep: 50)")
+      ("report-repeats", po::bool_switch(&opts->m_report_repeats),
+       "also report each timed iteration (small-message benchmarks: batch) separately, not just the distribution")
+      ("prefault-mi", po::value<size_t>(&opts->m_prefault_mi)->default_value(opts->m_prefault_mi),
+       "before the benchmarks, fault in this many MiB of session-SHM and app-SHM pages on both sides (0: don't)")
+      ("bench", po::value<std::string>(&bench_str)->default_value(bench_str),
+       "comma-separated benchmark groups to run: capnp (large-payload request/response, possibly --sweep-ing sizes); "
+       "small (small-message ping-pong and one-way streaming; --warmup/--repeats count batches); "
+       "multi (small-message ping-pong from each of --clients concurrent client processes); "
+       "open (session open/close and channel open latency, per transport; plus isolated primitives for reference); "
+       "transports (small-message ping-pong and streaming over each of --transports); "
+       "async (small-message and raw ping-pong via the async-I/O API vs. the sync_io one); "
+       "stl (SHM-native STL containers of each of --stl-elems sizes: build, lend/borrow, traverse)")
+      ("open-shm-pool-mi", po::value<size_t>(&opts->m_open_shm_pool_mi)->default_value(opts->m_open_shm_pool_mi),
+       "session-open benchmark (SHM-classic): size (MiB) of the SHM pool of the isolated pool-create+map primitive")
+      ("small-count", po::value<unsigned int>(&opts->m_small_n_msgs)->default_value(opts->m_small_n_msgs),
+       "small-message benchmarks: messages per batch")
+      ("clients", po::value<std::string>(&clients_str)->default_value(clients_str),
+       "multi-client benchmark: comma-separated numbers of concurrent client processes to run it with")
+      ("transports", po::value<std::string>(&transports_str)->default_value(transports_str),
+       "transport-matrix benchmark: comma-separated transports to compare")
+      ("stl-elems", po::value<std::string>(&stl_elems_str)->default_value(stl_elems_str),
+       "SHM-native STL benchmark: comma-separated container element counts")
+      ("load-child-out", po::value<std::string>(&opts->m_load_child_out), "(internal: multi-client benchmark)")
+      ("load-group", po::value<unsigned int>(&opts->m_load_group), "(internal: multi-client benchmark)")
+      ("counters", po::bool_switch(&opts->m_counters),
+       "also capture perf_event (cycles, instructions, cache misses, page faults, context switches) and getrusage "
+       "counters around the timed sections; report them next to the latencies")
+      ("results-file", po::value<std::string>(&opts->m_results_file),
+       "also write machine-readable results (CSV) to this file; compare two such files with perf_demo_compare.exec");
+    pos_desc.add("log-file", 1);
+  }
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).options(opts_desc).positional(pos_desc).run(), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& exc)
+  {
+    cerr << exc.what() << "\n\n" << opts_desc << "\n";
+    return Parse_result::S_BAD_USAGE;
+  }
+  if (vm.count("help") != 0)
+  {
+    cout << opts_desc << "\n";
+    return Parse_result::S_HELP;
+  }
+
+  std::istringstream cpus_is(cpus_list_str);
+  for (std::string cpu_str; std::getline(cpus_is, cpu_str, ','); )
+  {
+    unsigned int cpu = 0;
+    std::istringstream cpu_is(cpu_str);
+    if (!((cpu_is >> cpu) && cpu_is.eof() && (cpu < CPU_SETSIZE)))
+    {
+      cerr << "Bad CPU [" << cpu_str << "].\n\n" << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+    opts->m_cpus.push_back(cpu);
+  }
+
+  if (opts->m_sweep)
+  {
+    // Sweeping is about steady-state distributions; so unless told otherwise do not do a cold one-shot.
+    if (vm.count("warmup") == 0)
+    {
+      opts->m_n_warmup = 5;
+    }
+    if (vm.count("repeats") == 0)
+    {
+      opts->m_n_repeats = 50;
+    }
+    if ((opts->m_sweep_min_sz == 0) || (opts->m_sweep_min_sz > opts->m_sweep_max_sz) || (opts->m_sweep_n_sizes == 0))
+    {
+      cerr << "Sweep sizes must satisfy 0 < min <= max; and there must be at least 1 of them.\n\n"
+           << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+  }
+  if (!srv_else_cli)
+  {
+    opts->m_bench_capnp = false;
+    std::istringstream bench_is(bench_str);
+    for (std::string bench; std::getline(bench_is, bench, ','); )
+    {
+      if (bench == "capnp")
+      {
+        opts->m_bench_capnp = true;
+      }
+      else if (bench == "small")
+      {
+        opts->m_bench_small = true;
+      }
+      else if (bench == "multi")
+      {
+        opts->m_bench_multi = true;
+      }
+      else if (bench == "open")
+      {
+        opts->m_bench_open = true;
+      }
+      else if (bench == "transports")
+      {
+        opts->m_bench_transports = true;
+      }
+      else if (bench == "async")
+      {
+        opts->m_bench_async = true;
+      }
+      else if (bench == "stl")
+      {
+        opts->m_bench_stl = true;
+      }
+      else
+      {
+        cerr << "Unknown benchmark group [" << bench << "].\n\n" << opts_desc << "\n";
+        return Parse_result::S_BAD_USAGE;
+      }
+    }
+    opts->m_n_clients_list.clear();
+    std::istringstream clients_is(clients_str);
+    for (std::string n_clients_str; std::getline(clients_is, n_clients_str, ','); )
+    {
+      unsigned int n_clients = 0;
+      std::istringstream n_clients_is(n_clients_str);
+      if (!((n_clients_is >> n_clients) && n_clients_is.eof() && (n_clients != 0)))
+      {
+        cerr << "Bad client count [" << n_clients_str << "].\n\n" << opts_desc << "\n";
+        return Parse_result::S_BAD_USAGE;
+      }
+      if (std::find(opts->m_n_clients_list.begin(), opts->m_n_clients_list.end(), n_clients)
+            != opts->m_n_clients_list.end())
+      {
+        cerr << "Client count [" << n_clients << "] listed twice.\n\n" << opts_desc << "\n";
+        return Parse_result::S_BAD_USAGE;
+      }
+      opts->m_n_clients_list.push_back(n_clients);
+    }
+    if (opts->m_bench_multi && opts->m_n_clients_list.empty())
+    {
+      cerr << "There must be at least 1 client count for the multi-client benchmark.\n\n" << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+    opts->m_stl_n_elems_list.clear();
+    std::istringstream stl_elems_is(stl_elems_str);
+    for (std::string n_elems_str; std::getline(stl_elems_is, n_elems_str, ','); )
+    {
+      size_t n_elems = 0;
+      std::istringstream n_elems_is(n_elems_str);
+      if (!((n_elems_is >> n_elems) && n_elems_is.eof() && (n_elems != 0)))
+      {
+        cerr << "Bad STL element count [" << n_elems_str << "].\n\n" << opts_desc << "\n";
+        return Parse_result::S_BAD_USAGE;
+      }
+      if (std::find(opts->m_stl_n_elems_list.begin(), opts->m_stl_n_elems_list.end(), n_elems)
+            != opts->m_stl_n_elems_list.end())
+      {
+        cerr << "STL element count [" << n_elems << "] listed twice.\n\n" << opts_desc << "\n";
+        return Parse_result::S_BAD_USAGE;
+      }
+      opts->m_stl_n_elems_list.push_back(n_elems);
+    }
+    if (opts->m_bench_stl && opts->m_stl_n_elems_list.empty())
+    {
+      cerr << "There must be at least 1 element count for the SHM-native STL benchmark.\n\n" << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+    std::istringstream transports_is(transports_str);
+    for (std::string transport_str; std::getline(transports_is, transport_str, ','); )
+    {
+      size_t idx = 0;
+      while ((idx != size_t(Transport::S_END_SENTINEL)) && (transport_name(Transport(idx)) != transport_str))
+      {
+        ++idx;
+      }
+      if (idx == size_t(Transport::S_END_SENTINEL))
+      {
+        cerr << "Unknown transport [" << transport_str << "].\n\n" << opts_desc << "\n";
+        return Parse_result::S_BAD_USAGE;
+      }
+      if (std::find(opts->m_transports.begin(), opts->m_transports.end(), Transport(idx)) != opts->m_transports.end())
+      {
+        cerr << "Transport [" << transport_str << "] listed twice.\n\n" << opts_desc << "\n";
+        return Parse_result::S_BAD_USAGE;
+      }
+      opts->m_transports.push_back(Transport(idx));
+    }
+    if (opts->m_bench_transports && opts->m_transports.empty())
+    {
+      cerr << "There must be at least 1 transport for the transport-matrix benchmark.\n\n" << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+
+    if (!(opts->m_bench_capnp || opts->m_bench_small || opts->m_bench_multi || opts->m_bench_open
+          || opts->m_bench_transports || opts->m_bench_async || opts->m_bench_stl))
+    {
+      cerr << "There must be at least 1 benchmark group.\n\n" << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+    if (opts->m_small_n_msgs == 0)
+    {
+      cerr << "There must be at least 1 message per small-message batch.\n\n" << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+    if (opts->m_open_shm_pool_mi == 0)
+    {
+      cerr << "The session-open benchmark's SHM pool must be at least 1 MiB.\n\n" << opts_desc << "\n";
+      return Parse_result::S_BAD_USAGE;
+    }
+  }
+  if (opts->m_n_repeats == 0)
+  {
+    cerr << "There must be at least 1 timed repeat.\n\n" << opts_desc << "\n";
+    return Parse_result::S_BAD_USAGE;
+  }
+
+  return Parse_result::S_RUN;
+} // parse_options()
+
 void setup_logging(std::optional<flow::log::Simple_ostream_logger>* std_logger,
                    std::optional<flow::log::Async_file_logger>* log_logger,
-                   int argc, char const * const * argv, bool srv_else_cli)
+                   const Options& opts, bool srv_else_cli)
 {
   using flow::util::String_view;
   using flow::util::ostream_op_string;
@@ -104,8 +448,7 @@ void setup_logging(std::optional<flow::log::Simple_ostream_logger>* std_logger,
 
   // This is separate: the IPC/Flow logging will go into this file.
   const auto LOG_FILE = ostream_op_string(S_EXEC_PREFIX, srv_else_cli ? SRV_NAME : CLI_NAME, ".log");
-  const size_t ARG_IDX = srv_else_cli ? 2 : 1;
-  const auto log_file = (size_t(argc) > ARG_IDX) ? String_view(argv[ARG_IDX]) : String_view(LOG_FILE);
+  const auto log_file = opts.m_log_file.empty() ? String_view(LOG_FILE) : String_view(opts.m_log_file);
   FLOW_LOG_INFO("Opening log file [" << log_file << "] for IPC/Flow logs only.");
   static auto log_config = std_log_config;
   log_config.configure_default_verbosity(Sev::S_INFO, true);
@@ -129,3 +472,427 @@ void ev_wait(Asio_handle* hndl_of_interest,
     (*on_active_ev_func)();
   });
 }
+
+std::ostream& operator<<(std::ostream& os, const Spin_stats& stats)
+{
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  os.setf(std::ios::fixed);
+  os.precision(1);
+  const auto n = stats.m_hits + stats.m_misses;
+  os << "spin hits/misses [" << stats.m_hits << " / " << stats.m_misses << "] "
+        "(" << ((n == 0) ? 0. : (100. * double(stats.m_hits) / double(n))) << "% hits)";
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+void run_event_loop(Task_engine* task_engine, unsigned int spin_usec, Spin_stats* stats)
+{
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+
+  if (spin_usec == 0)
+  {
+    task_engine->run();
+    return;
+  }
+  // else
+
+  /* .poll() runs whatever handlers are ready (checking the reactor, i.e., epoll, without blocking) and returns their
+   * count; .run_one() blocks until one is ready and runs it.  Both return 0 and flip the "stopped" switch on running
+   * out of work, as .run() would; and do nothing once someone .stop()s (as our benchmarks do when done).
+   * Hence .stopped() is the loop's exit condition either way. */
+  const Fine_duration spin = boost::chrono::microseconds(spin_usec);
+  while (!task_engine->stopped())
+  {
+    const auto spin_end = Fine_clock::now() + spin;
+    bool hit = false;
+    do
+    {
+      hit = task_engine->poll() != 0;
+    }
+    while ((!hit) && (!task_engine->stopped()) && (Fine_clock::now() < spin_end));
+
+    if (hit)
+    {
+      ++stats->m_hits;
+    }
+    else if (!task_engine->stopped())
+    {
+      ++stats->m_misses;
+      task_engine->run_one();
+    }
+  }
+} // run_event_loop()
+
+Latency_stats::Latency_stats(std::vector<flow::Fine_duration> samples) :
+  m_n_samples(samples.size())
+{
+  using flow::Fine_duration;
+
+  if (samples.empty())
+  {
+    return;
+  }
+  // else
+
+  std::sort(samples.begin(), samples.end());
+  const auto pctl = [&](double pct) -> Fine_duration
+  {
+    // Nearest-rank: smallest sample such that at least pct% of samples are <= it.
+    const auto rank = size_t(std::ceil(pct / 100. * double(m_n_samples)));
+    return samples[std::clamp(rank, size_t(1), m_n_samples) - 1];
+  };
+
+  m_min = samples.front();
+  m_p50 = pctl(50);
+  m_p99 = pctl(99);
+  m_p99_9 = pctl(99.9);
+  m_max = samples.back();
+  m_mean = std::accumulate(samples.begin(), samples.end(), Fine_duration::zero()) / Fine_duration::rep(m_n_samples);
+}
+
+double to_usec(flow::Fine_duration dur)
+{
+  return double(boost::chrono::round<boost::chrono::nanoseconds>(dur).count()) / 1000.;
+}
+
+uint64_t process_ctx_switches()
+{
+  ::rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return uint64_t(usage.ru_nvcsw) + uint64_t(usage.ru_nivcsw);
+}
+
+std::ostream& operator<<(std::ostream& os, const Latency_stats& stats)
+{
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  os.setf(std::ios::fixed);
+  os.precision(1);
+  os << "min/p50/p99/p99.9/max = [" << to_usec(stats.m_min) << " / " << to_usec(stats.m_p50) << " / "
+     << to_usec(stats.m_p99) << " / " << to_usec(stats.m_p99_9) << " / " << to_usec(stats.m_max) << "] usec "
+        "(n = " << stats.m_n_samples << ')';
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+void add_result_rows(Result_rows* rows, const std::string& bench, const std::string& config,
+                     const Latency_stats& stats)
+{
+  rows->push_back({ bench, config, "n_samples", double(stats.m_n_samples) });
+  rows->push_back({ bench, config, "min_usec", to_usec(stats.m_min) });
+  rows->push_back({ bench, config, "p50_usec", to_usec(stats.m_p50) });
+  rows->push_back({ bench, config, "p99_usec", to_usec(stats.m_p99) });
+  rows->push_back({ bench, config, "p99_9_usec", to_usec(stats.m_p99_9) });
+  rows->push_back({ bench, config, "max_usec", to_usec(stats.m_max) });
+  rows->push_back({ bench, config, "mean_usec", to_usec(stats.m_mean) });
+}
+
+void add_repeat_rows(Result_rows* rows, const std::string& bench, const std::string& config,
+                     const std::vector<flow::Fine_duration>& samples)
+{
+  for (size_t idx = 0; idx != samples.size(); ++idx)
+  {
+    rows->push_back({ bench, config, "repeat_" + std::to_string(idx + 1) + "_usec", to_usec(samples[idx]) });
+  }
+}
+
+std::string result_config_base(Transport transport)
+{
+  // See Transport (etc.) in common.hpp.  (Naming of the S_SOCKET one predates the others'.)
+  std::string config = "transport=";
+  switch (transport_mq_type(transport))
+  {
+  case ipc::session::schema::MqType::POSIX:
+    config += "posix_mq";
+    break;
+  case ipc::session::schema::MqType::BIPC:
+    config += "bipc_mq";
+    break;
+  default:
+    config += "local_stream_socket";
+  }
+  if (transport_native_handles(transport))
+  {
+    config += ";native_handles=1";
+  }
+  return config + ";shm="
+#if JEM_ELSE_CLASSIC
+         "jemalloc";
+#else
+         "classic";
+#endif
+}
+
+Counter_values Counter_values::per(double n) const
+{
+  Counter_values result = *this;
+  for (auto* val : { &result.m_cycles, &result.m_instructions, &result.m_cache_misses, &result.m_page_faults,
+                     &result.m_ctx_switches })
+  {
+    if (*val)
+    {
+      **val /= n;
+    }
+  }
+  for (auto* val : { &result.m_minor_faults, &result.m_major_faults, &result.m_vol_ctx_switches,
+                     &result.m_invol_ctx_switches, &result.m_user_cpu_usec, &result.m_sys_cpu_usec })
+  {
+    *val /= n;
+  }
+  return result;
+}
+
+std::ostream& operator<<(std::ostream& os, const Counter_values& values)
+{
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  os.setf(std::ios::fixed);
+  os.precision(1);
+  const auto print = [&](const char* name, const std::optional<double>& val)
+  {
+    os << name << " [";
+    if (val)
+    {
+      os << *val;
+    }
+    else
+    {
+      os << "n/a";
+    }
+    os << "] ";
+  };
+  print("cycles", values.m_cycles);
+  print("instructions", values.m_instructions);
+  if (values.m_cycles && values.m_instructions && (*values.m_cycles != 0))
+  {
+    os.precision(2);
+    os << "(IPC [" << (*values.m_instructions / *values.m_cycles) << "]) ";
+    os.precision(1);
+  }
+  print("cache-misses", values.m_cache_misses);
+  print("page-faults", values.m_page_faults);
+  print("ctx-switches", values.m_ctx_switches);
+  if (values.m_multiplexed)
+  {
+    os << "(multiplexed: scaled) ";
+  }
+  os << "| rusage: minor/major-faults [" << values.m_minor_faults << " / " << values.m_major_faults << "] "
+        "vol/invol-ctx-switches [" << values.m_vol_ctx_switches << " / " << values.m_invol_ctx_switches << "] "
+        "user/sys-CPU [" << values.m_user_cpu_usec << " / " << values.m_sys_cpu_usec << "] usec";
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+void add_counter_rows(Result_rows* rows, const std::string& bench, const std::string& config,
+                      const Counter_values& values, const std::string& unit)
+{
+  const auto add = [&](const char* name, double val)
+  {
+    rows->push_back({ bench, config, std::string(name) + "_per_" + unit, val });
+  };
+  const auto add_opt = [&](const char* name, const std::optional<double>& val)
+  {
+    if (val)
+    {
+      add(name, *val);
+    }
+  };
+  add_opt("perf_cycles", values.m_cycles);
+  add_opt("perf_instructions", values.m_instructions);
+  add_opt("perf_cache_misses", values.m_cache_misses);
+  add_opt("perf_page_faults", values.m_page_faults);
+  add_opt("perf_ctx_switches", values.m_ctx_switches);
+  if (values.m_cycles || values.m_instructions || values.m_cache_misses || values.m_page_faults
+      || values.m_ctx_switches)
+  {
+    // Not per unit: it's a flag.
+    rows->push_back({ bench, config, "perf_multiplexed", values.m_multiplexed ? 1. : 0. });
+  }
+  add("rusage_minor_faults", values.m_minor_faults);
+  add("rusage_major_faults", values.m_major_faults);
+  add("rusage_vol_ctx_switches", values.m_vol_ctx_switches);
+  add("rusage_invol_ctx_switches", values.m_invol_ctx_switches);
+  add("rusage_user_cpu_usec", values.m_user_cpu_usec);
+  add("rusage_sys_cpu_usec", values.m_sys_cpu_usec);
+}
+
+Perf_counters::Perf_counters()
+{
+  m_fds.fill(-1);
+}
+
+Perf_counters::~Perf_counters()
+{
+  for (const auto fd : m_fds)
+  {
+    if (fd != -1)
+    {
+      ::close(fd);
+    }
+  }
+}
+
+void Perf_counters::open(flow::log::Logger* logger_ptr)
+{
+  FLOW_LOG_SET_CONTEXT(logger_ptr, flow::Flow_log_component::S_UNCAT);
+
+  struct Event_spec
+  {
+    const char* m_name;
+    uint32_t m_type;
+    uint64_t m_config;
+  };
+  const std::array<Event_spec, S_N_EVENTS> specs
+    {{ { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+       { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+       { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+       { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+       { "ctx-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES } }};
+
+  /* Each counter is opened on its own, not as a group: a group cannot be read (as a whole) with `inherit` set; and
+   * we need that to count the threads of this process other than this one, which is where Flow-IPC does some of its
+   * work.  No need to enable/disable them around each section either: we simply read them at start() and stop(). */
+  for (size_t idx = 0; idx != S_N_EVENTS; ++idx)
+  {
+    ::perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = specs[idx].m_type;
+    attr.config = specs[idx].m_config;
+    attr.inherit = 1;
+    attr.exclude_hv = 1;
+    /* If there are more events (ours, or anyone else's on the CPU) than hardware counters, the kernel time-slices
+     * them; so have it report for how long each was enabled versus running, to scale by (see stop()). */
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if ((fd == -1) && ((errno == EACCES) || (errno == EPERM)))
+    {
+      // Probably perf_event_paranoid >= 2: no kernel-side counting for us.  User-side is better than nothing.
+      attr.exclude_kernel = 1;
+      fd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+      if (fd != -1)
+      {
+        FLOW_LOG_INFO("Counters: [" << specs[idx].m_name << "] will count user-space only (not permitted "
+                      "to count kernel-space; see /proc/sys/kernel/perf_event_paranoid).");
+      }
+    }
+    if (fd == -1)
+    {
+      FLOW_LOG_WARNING("Counters: [" << specs[idx].m_name << "] unavailable "
+                       "(perf_event_open() error [" << Error_code(errno, boost::system::system_category()) << "]); "
+                       "will report it as n/a.");
+    }
+    m_fds[idx] = fd;
+  }
+
+  m_open = true;
+}
+
+bool Perf_counters::is_open() const
+{
+  return m_open;
+}
+
+void Perf_counters::start()
+{
+  if (m_open)
+  {
+    m_section_start = snapshot();
+  }
+}
+
+void Perf_counters::stop()
+{
+  if (!m_open)
+  {
+    return;
+  }
+  // else
+
+  const auto end_snap = snapshot();
+  const auto& start = m_section_start.m_values;
+  const auto& end = end_snap.m_values;
+  /* If either read() of a section failed, that section's delta is unknown; and so then is the sum over the sections
+   * (a partial one would be silently low): report the counter as unavailable until the next take().  Same if the
+   * counter was enabled but never got to run in the section (multiplexed out the whole time).  If it ran for only
+   * part of the time, scale its delta up accordingly, as perf(1) does; and note that it's an estimate. */
+  const auto add_delta = [&](Event event, std::optional<double> Counter_values::* val)
+  {
+    const auto enabled = end_snap.m_time_enabled[event] - m_section_start.m_time_enabled[event];
+    const auto running = end_snap.m_time_running[event] - m_section_start.m_time_running[event];
+    if (!((start.*val) && (end.*val)) || ((running == 0) && (enabled != 0)))
+    {
+      m_unavailable[event] = true;
+    }
+    if (m_unavailable[event])
+    {
+      (m_total.*val).reset();
+      return;
+    }
+    // else
+    auto delta = *(end.*val) - *(start.*val);
+    if (running < enabled)
+    {
+      delta *= double(enabled) / double(running);
+      m_total.m_multiplexed = true;
+    }
+    m_total.*val = (m_total.*val).value_or(0) + delta;
+  };
+  add_delta(S_CYCLES, &Counter_values::m_cycles);
+  add_delta(S_INSTRUCTIONS, &Counter_values::m_instructions);
+  add_delta(S_CACHE_MISSES, &Counter_values::m_cache_misses);
+  add_delta(S_PAGE_FAULTS, &Counter_values::m_page_faults);
+  add_delta(S_CTX_SWITCHES, &Counter_values::m_ctx_switches);
+  m_total.m_minor_faults += end.m_minor_faults - start.m_minor_faults;
+  m_total.m_major_faults += end.m_major_faults - start.m_major_faults;
+  m_total.m_vol_ctx_switches += end.m_vol_ctx_switches - start.m_vol_ctx_switches;
+  m_total.m_invol_ctx_switches += end.m_invol_ctx_switches - start.m_invol_ctx_switches;
+  m_total.m_user_cpu_usec += end.m_user_cpu_usec - start.m_user_cpu_usec;
+  m_total.m_sys_cpu_usec += end.m_sys_cpu_usec - start.m_sys_cpu_usec;
+}
+
+Counter_values Perf_counters::take()
+{
+  Counter_values total;
+  std::swap(total, m_total);
+  m_unavailable.fill(false);
+  return total;
+}
+
+Perf_counters::Snapshot Perf_counters::snapshot() const
+{
+  Snapshot snap;
+  auto& values = snap.m_values;
+  const auto read_event = [&](Event event) -> std::optional<double>
+  {
+    // Per read_format (see open()): value, time enabled, time running.
+    uint64_t buf[3];
+    if ((m_fds[event] == -1) || (::read(m_fds[event], buf, sizeof(buf)) != ssize_t(sizeof(buf))))
+    {
+      return std::nullopt;
+    }
+    snap.m_time_enabled[event] = buf[1];
+    snap.m_time_running[event] = buf[2];
+    return double(buf[0]);
+  };
+  values.m_cycles = read_event(S_CYCLES);
+  values.m_instructions = read_event(S_INSTRUCTIONS);
+  values.m_cache_misses = read_event(S_CACHE_MISSES);
+  values.m_page_faults = read_event(S_PAGE_FAULTS);
+  values.m_ctx_switches = read_event(S_CTX_SWITCHES);
+
+  ::rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  values.m_minor_faults = double(usage.ru_minflt);
+  values.m_major_faults = double(usage.ru_majflt);
+  values.m_vol_ctx_switches = double(usage.ru_nvcsw);
+  values.m_invol_ctx_switches = double(usage.ru_nivcsw);
+  values.m_user_cpu_usec = double(usage.ru_utime.tv_sec) * 1000000. + double(usage.ru_utime.tv_usec);
+  values.m_sys_cpu_usec = double(usage.ru_stime.tv_sec) * 1000000. + double(usage.ru_stime.tv_usec);
+  return snap;
+}
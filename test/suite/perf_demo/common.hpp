@@ -16,7 +16,9 @@
  * permissions and limitations under the License. */
 
 #include "schema.capnp.h"
+#include "results.hpp"
 #include <ipc/transport/bipc_mq_handle.hpp>
+#include <ipc/transport/struc/heap_serializer.hpp>
 #include <ipc/session/shm/arena_lend/jemalloc/client_session.hpp>
 #include <ipc/session/shm/arena_lend/jemalloc/session_server.hpp>
 #include <ipc/session/shm/classic/client_session.hpp>
@@ -25,8 +27,15 @@
 #include <flow/log/simple_ostream_logger.hpp>
 #include <flow/log/async_file_logger.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/interprocess/containers/map.hpp>
+#include <boost/interprocess/containers/string.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <array>
 #include <string>
+#include <type_traits>
 #include <optional>
+#include <vector>
+#include <ostream>
 
 namespace fs = boost::filesystem;
 
@@ -42,31 +51,444 @@ using Error_code = flow::Error_code;
 using Runtime_error = flow::error::Runtime_error;
 using Blob = flow::util::Blob_sans_log_context;
 
-// Session will emit Unix-domain-socket-transport-based channels.  Structured-channels will be zero-copy-enabled.
 #if JEM_ELSE_CLASSIC
 namespace ssn = ipc::session::shm::arena_lend::jemalloc;
 #else
 namespace ssn = ipc::session::shm::classic;
 #endif
 
-using Client_session = ssn::Client_session<ipc::session::schema::MqType::NONE, false>;
-using Session_server = ssn::Session_server<ipc::session::schema::MqType::NONE, false>;
+/* The transports (pipe types) a session's channels can be built on, with the session type parameters each
+ * corresponds to.  S_SOCKET is what almost everything in this meta-app uses (Unix-domain-socket-based channels,
+ * without native-handle transmission); the server also accepts sessions of all the others (each via its own
+ * Session_server, with its own server app: see SRV_APPS and transport_srv_name()), for the transport-matrix
+ * benchmark to compare them side by side.  The `_HNDL` ones can transmit native handles: with the MQ-based ones
+ * that means a Unix domain socket alongside the MQs. */
+enum class Transport : size_t
+{
+  S_SOCKET = 0,
+  S_SOCKET_HNDL,
+  S_POSIX_MQ,
+  S_POSIX_MQ_HNDL,
+  S_BIPC_MQ,
+  S_BIPC_MQ_HNDL,
+  S_END_SENTINEL
+};
+
+constexpr ipc::session::schema::MqType transport_mq_type(Transport transport)
+{
+  using ipc::session::schema::MqType;
+  switch (transport)
+  {
+  case Transport::S_POSIX_MQ:
+  case Transport::S_POSIX_MQ_HNDL:
+    return MqType::POSIX;
+  case Transport::S_BIPC_MQ:
+  case Transport::S_BIPC_MQ_HNDL:
+    return MqType::BIPC;
+  default:
+    return MqType::NONE;
+  }
+}
+
+constexpr bool transport_native_handles(Transport transport)
+{
+  return (transport == Transport::S_SOCKET_HNDL) || (transport == Transport::S_POSIX_MQ_HNDL)
+         || (transport == Transport::S_BIPC_MQ_HNDL);
+}
+
+// Session-related types for a given Transport.  Structured-channels will be zero-copy-enabled.
+template<Transport S_TRANSPORT>
+struct Transport_types
+{
+  using Client_session = ssn::Client_session<transport_mq_type(S_TRANSPORT), transport_native_handles(S_TRANSPORT)>;
+  using Session_server = ssn::Session_server<transport_mq_type(S_TRANSPORT), transport_native_handles(S_TRANSPORT)>;
+  // Same as Session_server::Server_session_obj::Channel_obj.
+  using Channel_raw = typename Client_session::Channel_obj;
+  using Channel_struc = typename Client_session::template Structured_channel<perf_demo::schema::Body>::Sync_io_obj;
+  using Channel_struc_heap
+    = typename ipc::transport::struc::Channel_via_heap<Channel_raw, perf_demo::schema::Body>::Sync_io_obj;
+};
+
+// Name of the transport in `--transports` and in results files (config `transport=...`).
+const std::string& transport_name(Transport transport);
+// Name of the server app (see SRV_APPS) whose Session_server accepts sessions using the transport.
+const std::string& transport_srv_name(Transport transport);
+
+// Session will emit Unix-domain-socket-transport-based channels, unless it's the transport-matrix benchmark.
+using Client_session = Transport_types<Transport::S_SOCKET>::Client_session;
+using Session_server = Transport_types<Transport::S_SOCKET>::Session_server;
 // We'll use an unstructured channel of this type (again, Unix domain socket underneath) to time non-zero-copy xmission.
-using Channel_raw = Client_session::Channel_obj;
+using Channel_raw = Transport_types<Transport::S_SOCKET>::Channel_raw;
 // We'll use a structured channel of this type to time zero-copy transmission of capnp-backed structured data.
-using Channel_struc = Client_session::Structured_channel<perf_demo::schema::Body>::Sync_io_obj;
+using Channel_struc = Transport_types<Transport::S_SOCKET>::Channel_struc;
+/* And one of this type (same thing but non-zero-copy: capnp serialization is in heap segments copied into and out of
+ * the transport) for the small-message benchmarks, where the fixed per-message cost is what we are after. */
+using Channel_struc_heap = Transport_types<Transport::S_SOCKET>::Channel_struc_heap;
+
+/* The init-channels the server offers, by index.  S_CHAN_RAW is used raw; the S_CHAN_STRUC_* ones are each upgraded
+ * to a structured channel with the serialization noted (by both sides; the app-SHM one is a slight exception on the
+ * client side: see main_cli.cpp).  S_CHAN_STRUC_ASYNC is session-SHM-backed too; but the client uses it via the
+ * async-I/O struc::Channel API (the rest are all used via the sync_io-pattern API).  S_CHAN_ECHO and S_CHAN_ECHO_ASYNC
+ * are raw, and the server echoes back whatever it receives over them; the client uses their Native_socket_streams
+ * directly, via the sync_io and async-I/O API respectively.  (Those last 3 are for the async-I/O-vs-sync_io
+ * benchmark.)
+ *
+ * That's for S_SOCKET sessions.  Those of the other transports get only the first S_N_TRANSPORT_CHANS: the
+ * transport-matrix benchmark needs no more; and heap-serialized structured messages would not fit into MQ messages
+ * anyway (in a SHM-enabled session the latter are sized to fit SHM handles, not data). */
+enum Chan_idx : size_t
+{
+  S_CHAN_RAW = 0,
+  S_CHAN_STRUC_SESSION_SHM,
+  S_N_TRANSPORT_CHANS,
+  S_CHAN_STRUC_HEAP = S_N_TRANSPORT_CHANS,
+  S_CHAN_STRUC_APP_SHM,
+  S_CHAN_STRUC_ASYNC,
+  S_CHAN_ECHO,
+  S_CHAN_ECHO_ASYNC,
+  S_N_CHANS
+};
+
+// Size of each message of the raw (unstructured) echo benchmarks.  See S_CHAN_ECHO.
+constexpr size_t S_ECHO_MSG_SZ = 64;
+
+/* The C++ containers of the SHM-native STL benchmark (see GetStlReq in schema.capnp), as seen by the owner (the
+ * server, which builds them in SHM) if S_OWN_ELSE_BRW; else by the borrower (the client, which reads them in place).
+ * Per Flow-IPC docs the owner uses Session::Allocator, the borrower Session::Borrower_allocator; with SHM-classic
+ * those are one and the same, while with SHM-jemalloc they are not (but the containers' layouts are identical).
+ * Session is the server-side or client-side session type, respectively. */
+template<typename Session, bool S_OWN_ELSE_BRW>
+struct Shm_stl
+{
+  template<typename T>
+  using Allocator = std::conditional_t<S_OWN_ELSE_BRW, typename Session::template Allocator<T>,
+                                       typename Session::template Borrower_allocator<T>>;
+
+  using String = boost::interprocess::basic_string<char, std::char_traits<char>, Allocator<char>>;
+  using Vector = boost::interprocess::vector<uint64_t, Allocator<uint64_t>>;
+  using Map = boost::interprocess::map<uint64_t, String, std::less<uint64_t>,
+                                       Allocator<std::pair<const uint64_t, String>>>;
+};
+
+/* Size of each Shm_stl::Map value: long enough to not fit into the string object itself (small-string optimization);
+ * so that each value is an allocation of its own, as in a real cache. */
+constexpr size_t S_STL_MAP_VAL_SZ = 48;
+
+/* Reads every element of a Shm_stl container (on either side); returns a checksum, so that the borrower can tell it
+ * read the same thing the owner built. */
+template<typename Container>
+uint64_t stl_checksum(const Container& container)
+{
+  uint64_t sum = 0;
+  for (const auto& elem : container)
+  {
+    if constexpr(std::is_integral_v<std::decay_t<decltype(elem)>>)
+    {
+      sum += uint64_t(elem); // Vector (integers) or String (chars).
+    }
+    else
+    {
+      sum += elem.first + elem.second.size() + uint64_t(elem.second.front()); // Map.
+    }
+  }
+  return sum;
+}
 
 using Task_engine = flow::util::Task_engine; // A/k/a boost::asio::io_context.
 using Asio_handle = ipc::util::sync_io::Asio_waitable_native_handle;
 using Blob_const = ipc::util::Blob_const;
 using Blob_mutable = ipc::util::Blob_mutable;
 
+/* Command-line configuration of either program.  Not every member applies to both programs; parse_options()
+ * only accepts (and its usage message only lists) the ones relevant to the given side; the rest keep their
+ * defaults.  Positional args are accepted as before these became options, so existing invocations like
+ * `./perf_demo_srv_shm_classic.exec 1000 srv.log` and `./perf_demo_cli_shm_classic.exec cli.log` keep working. */
+struct Options
+{
+  // Both: IPC/Flow log file (console gets our own logging).  Empty => default name.
+  std::string m_log_file;
+
+  // Server: rough size of the capnp payload prepared at startup (client may request different ones later).
+  float m_total_sz_mi = 1000;
+
+  /* Both: pin the process (all its threads) to these CPUs (`--cpus`); so that the scheduler does not migrate things
+   * mid-benchmark.  Empty => no pinning. */
+  std::vector<unsigned int> m_cpus;
+  /* Both: spin-then-block event loop (`--spin-usec`): before blocking for readiness of anything (e.g., an incoming
+   * message), busy-poll for up to this long; trading a core for the wakeup latency.  0 => block right away (as
+   * before).  See run_event_loop(). */
+  unsigned int m_spin_usec = 0;
+
+  /* Client: run the payload-size sweep: for each of m_sweep_n_sizes sizes (log-spaced between min and max inclusive)
+   * run both capnp benchmarks m_n_warmup + m_n_repeats times, reporting the distribution of the latter.
+   * Otherwise: just one size (whatever the server prepared at startup). */
+  bool m_sweep = false;
+  size_t m_sweep_min_sz = 100;
+  size_t m_sweep_max_sz = size_t(1024) * 1024 * 1024;
+  unsigned int m_sweep_n_sizes = 16;
+  /* Client: untimed iterations before the timed ones, and timed iterations, per benchmark (per size).
+   * Defaults are 0 and 1 (one-shot, cold) unless m_sweep, in which case they are 5 and 50. */
+  unsigned int m_n_warmup = 0;
+  unsigned int m_n_repeats = 1;
+  /* Client: also report each timed repeat (capnp and STL: iteration; small-message benchmarks: batch) separately, in
+   * order, not just their distribution (`--report-repeats`); in the console and the results file. */
+  bool m_report_repeats = false;
+  /* Client: before the benchmarks, fault in this many MiB of session-SHM and app-SHM pages, on both sides
+   * (`--prefault-mi`); so that the first timed iterations do not pay for that.  0 => don't. */
+  size_t m_prefault_mi = 0;
+
+  // Client: which benchmark groups to run (`--bench`): large-payload capnp request/response; small messages; ....
+  bool m_bench_capnp = true;
+  bool m_bench_small = false;
+  /* Client: session-open/channel-open/session-close latency benchmark (`--bench=open`); m_n_warmup and m_n_repeats
+   * count (untimed and timed) open/close cycles. */
+  bool m_bench_open = false;
+  /* Client: session-open benchmark: size (MiB) of the SHM pool its isolated pool-create+map primitive creates and maps
+   * (`--open-shm-pool-mi`).  The default is meant to match SHM-classic's default session pool size; if your build's
+   * differs, set it to that.  It goes into the results (run_setup), so runs with different ones are told apart. */
+  size_t m_open_shm_pool_mi = 2048;
+  /* Client: transport-matrix benchmark (`--bench=transports`): for each of m_transports, small-message ping-pong and
+   * streaming (as in m_bench_small, over a session-SHM-backed channel) in a session using that transport. */
+  bool m_bench_transports = false;
+  std::vector<Transport> m_transports;
+  /* Client: async-I/O-vs-sync_io benchmark (`--bench=async`): small-message ping-pong via a structured channel, and
+   * raw ping-pong via a Native_socket_stream, each via the sync_io API and the async-I/O one; m_small_n_msgs,
+   * m_n_warmup and m_n_repeats apply as in m_bench_small. */
+  bool m_bench_async = false;
+  /* Client: small-message benchmarks: messages per batch (ping-pong: round trips; streaming: one-way messages).
+   * m_n_warmup and m_n_repeats then count (untimed and timed) batches. */
+  unsigned int m_small_n_msgs = 100000;
+
+  /* Client: multi-client benchmark (`--bench=multi`): for each K in m_n_clients_list, K client processes (spawned
+   * by this one) each run small-message ping-pong (as in m_bench_small, over the session-SHM channel) concurrently;
+   * m_small_n_msgs, m_n_warmup and m_n_repeats apply to each of them. */
+  bool m_bench_multi = false;
+  std::vector<unsigned int> m_n_clients_list{ 1, 2, 4, 8 };
+  /* Client: SHM-native STL benchmark (`--bench=stl`): for each container kind (vector, map, string), each element
+   * count in m_stl_n_elems_list, and each of session-SHM and app-SHM: build (by server), lend/transmit/borrow of the
+   * handle, and traversal (by client) of the container; m_n_warmup and m_n_repeats count (untimed and timed)
+   * iterations of that. */
+  bool m_bench_stl = false;
+  std::vector<size_t> m_stl_n_elems_list{ 1000, 100000, 1000000 };
+  /* Client, internal: when this process is one of those spawned clients: where to write its raw results for the
+   * spawning process; and how many clients take part (so the server knows when all are ready to start). */
+  std::string m_load_child_out;
+  unsigned int m_load_group = 0;
+
+  /* Client: capture hardware and OS counters (see Perf_counters) around the timed sections and report them next to
+   * the latencies (`--counters`). */
+  bool m_counters = false;
+
+  // Client: if not empty, also write machine-readable results (see results.hpp) to this file.
+  std::string m_results_file;
+};
+
+/* Distribution summary of a set of timing samples (e.g., the RTTs of the timed repeats of a benchmark).
+ * Percentiles are nearest-rank; so with few samples the high ones simply equal the max -- e.g., p99.9 is only
+ * distinct from the max with 1000+ samples. */
+struct Latency_stats
+{
+  size_t m_n_samples = 0;
+  flow::Fine_duration m_min = flow::Fine_duration::zero();
+  flow::Fine_duration m_p50 = flow::Fine_duration::zero();
+  flow::Fine_duration m_p99 = flow::Fine_duration::zero();
+  flow::Fine_duration m_p99_9 = flow::Fine_duration::zero();
+  flow::Fine_duration m_max = flow::Fine_duration::zero();
+  flow::Fine_duration m_mean = flow::Fine_duration::zero();
+
+  Latency_stats() = default;
+  // Computes the summary; `samples` is taken by value, as we need to sort it.
+  explicit Latency_stats(std::vector<flow::Fine_duration> samples);
+};
+
+// Prints e.g. "min/p50/p99/p99.9/max = [10.1 / 12.0 / 30.4 / 30.4 / 30.4] usec (n = 50)".
+std::ostream& operator<<(std::ostream& os, const Latency_stats& stats);
+// Duration as (fractional) microseconds; for printing.
+double to_usec(flow::Fine_duration dur);
+/* Context switches (voluntary and involuntary) so far, of this whole process: all threads, including Flow-IPC's
+ * internal ones. */
+uint64_t process_ctx_switches();
+/* Appends to *rows one row per statistic of `stats` (n_samples, min_usec, p50_usec, ...), for benchmark `bench` in
+ * configuration `config`.  See results.hpp. */
+void add_result_rows(Result_rows* rows, const std::string& bench, const std::string& config,
+                     const Latency_stats& stats);
+/* Appends to *rows one row per sample in `samples` (repeat_1_usec, repeat_2_usec, ...), in order; for benchmark
+ * `bench` in configuration `config`.  See Options::m_report_repeats. */
+void add_repeat_rows(Result_rows* rows, const std::string& bench, const std::string& config,
+                     const std::vector<flow::Fine_duration>& samples);
+
+/* Hardware and OS counters over the timed sections of a benchmark (see Perf_counters); reported next to its
+ * latencies, so as to tell why something is as fast (or slow) as it is: e.g., a page-fault-bound SHM result versus
+ * a copy-bound heap one.  Totals over the sections; or, after per(), per unit of work (iteration, message...). */
+struct Counter_values
+{
+  /* perf_event_open() counters of this whole process: all threads, including Flow-IPC's internal ones; user and
+   * (if permitted: see `perf_event_paranoid`) kernel.  Each is absent if it could not be opened. */
+  std::optional<double> m_cycles;
+  std::optional<double> m_instructions;
+  std::optional<double> m_cache_misses;
+  std::optional<double> m_page_faults;
+  std::optional<double> m_ctx_switches;
+  /* Whether the kernel multiplexed any of the above in some section: ran it for only part of the time it was enabled
+   * (e.g., more events than hardware counters).  Its value is then an estimate, scaled up by enabled/running time. */
+  bool m_multiplexed = false;
+  // getrusage(RUSAGE_SELF) deltas; these are always available.
+  double m_minor_faults = 0;
+  double m_major_faults = 0;
+  double m_vol_ctx_switches = 0;
+  double m_invol_ctx_switches = 0;
+  double m_user_cpu_usec = 0;
+  double m_sys_cpu_usec = 0;
+
+  // The same, each divided by `n`.
+  Counter_values per(double n) const;
+};
+
+/* Prints e.g. "cycles [12345] instructions [23456] (IPC [1.90]) cache-misses [12] ... sys-CPU [1.5] usec"; noting
+ * it if m_multiplexed. */
+std::ostream& operator<<(std::ostream& os, const Counter_values& values);
+/* Appends to *rows one row per value in `values` (presumably per() some unit: `unit` names it), for benchmark `bench`
+ * in configuration `config`: e.g., `perf_cycles_per_msg`, `rusage_minor_faults_per_msg`; and, if there are perf_event
+ * values, `perf_multiplexed` (1 or 0).  See results.hpp. */
+void add_counter_rows(Result_rows* rows, const std::string& bench, const std::string& config,
+                      const Counter_values& values, const std::string& unit);
+
+/* Captures Counter_values over timed sections: start() and stop() bracket each one (outside whatever times it
+ * proper, so as to not skew that); take() returns the sum over the sections since the last take().  Until open()
+ * all of these do nothing (take() returns zeroes).  Not thread-safe; but start() and stop() may be called from
+ * different threads (e.g., a Flow-IPC async-I/O handler thread) as long as not concurrently. */
+class Perf_counters
+{
+public:
+  Perf_counters();
+  ~Perf_counters();
+  Perf_counters(const Perf_counters&) = delete;
+  Perf_counters& operator=(const Perf_counters&) = delete;
+
+  /* Opens the perf_event counters: those it can (e.g., hardware ones may be unavailable in a VM); logs the rest.
+   * Call before starting any threads one wants counted: the counters are inherited only by threads created after. */
+  void open(flow::log::Logger* logger_ptr);
+  bool is_open() const;
+
+  void start();
+  void stop();
+  Counter_values take();
+
+private:
+  enum Event : size_t
+  {
+    S_CYCLES = 0,
+    S_INSTRUCTIONS,
+    S_CACHE_MISSES,
+    S_PAGE_FAULTS,
+    S_CTX_SWITCHES,
+    S_N_EVENTS
+  };
+
+  /* Current absolute values (since open()); and, by Event, the time (nsec) the counter was enabled and the part of
+   * that it was actually running (counting), as the kernel reports them; these differ when it is multiplexed. */
+  struct Snapshot
+  {
+    Counter_values m_values;
+    std::array<uint64_t, S_N_EVENTS> m_time_enabled{};
+    std::array<uint64_t, S_N_EVENTS> m_time_running{};
+  };
+
+  Snapshot snapshot() const;
+
+  bool m_open = false;
+  // The perf_event FDs by Event; -1 if not opened.
+  std::array<int, S_N_EVENTS> m_fds;
+  Snapshot m_section_start;
+  Counter_values m_total;
+  // By Event: whether a read() failed in some section since the last take(); m_total's value is then unavailable.
+  std::array<bool, S_N_EVENTS> m_unavailable{};
+};
+
+/* Outcomes of the spinning in run_event_loop().  Hit: a spin found something ready (so the loop did not block);
+ * miss: a spin used up its budget, after which the loop blocked as usual.  Mostly misses => the budget is too small
+ * for the traffic at hand (or the traffic too sparse to spin for), and the spinning is pure waste. */
+struct Spin_stats
+{
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+};
+
+// Prints e.g. "spin hits/misses [12345 / 12] (99.9% hits)".
+std::ostream& operator<<(std::ostream& os, const Spin_stats& stats);
+/* Same as `task_engine->run()` if `spin_usec` (normally Options::m_spin_usec) is 0.  Otherwise: the same, except that
+ * whenever it would block (in epoll_wait()) for something to become ready, it first busy-polls (non-blocking
+ * .poll()s, each one a zero-timeout epoll_wait()) for up to that long; adding the outcome to *stats.  This works at
+ * the application level, above the sync_io pattern; so it applies to any channel of any transport (local socket,
+ * POSIX MQ, bipc MQ) whose sync_io event-wait handles are in `*task_engine`.  Hence also: a Flow-IPC internal thread
+ * (e.g., the bipc-MQ receiver's) still wakes up as before; only our own wakeup is spared. */
+void run_event_loop(Task_engine* task_engine, unsigned int spin_usec, Spin_stats* stats);
+
+/* The results-file config (see results.hpp) common to all benchmarks in this program: transport and SHM-provider.
+ * Benchmarks append their own specifics (e.g., `;size=...`). */
+std::string result_config_base(Transport transport = Transport::S_SOCKET);
+
+/* Control protocol.  The client program drives the benchmark run: it tells the server what to do next via these
+ * fixed-size messages over the raw (unstructured) channel, then times whatever it asked for; the server merely
+ * reacts.  Each command's `m_arg` semantics and the server's reaction are noted next to it. */
+struct Ctl_msg
+{
+  enum class Cmd : uint64_t
+  {
+    /* m_arg = rough capnp payload size in bytes to prepare for subsequent get-cache requests (both the heap-backed
+     * and SHM-backed copy); or 0 to keep the current one.  Server replies with the same command, m_arg = exact
+     * size of the data within (sum of file-part data sizes).  This is not timed; and it doubles as the initial
+     * sync handshake. */
+    S_PREP_CAPNP,
+    // Get-cache request for the raw (non-zero-copy) benchmark.  Server replies with the capnp segments.
+    S_GET_CACHE_RAW,
+    /* Switch to small-message mode.  m_arg = 0: ping-pong: server replies to each GetCacheReq (on any structured
+     * channel) with a freshly built small GetCacheRsp.  m_arg = N > 0: one-way streaming: server does not reply to
+     * GetCacheReqs but counts them, sending this same command (same m_arg) back every N of them.  Either way
+     * server acks immediately (same command and m_arg); and the mode lasts until the next S_SMALL_MSGS or
+     * S_PREP_CAPNP (the latter returning to serving the large capnp payload). */
+    S_SMALL_MSGS,
+    /* m_arg = K: client is ready to start the timed part of a multi-client benchmark, in which K clients (each with
+     * its own session) take part.  Server replies with the same command, to all K at once, when the K-th one
+     * is ready.  (With K = 1 it's a mere round trip, which tells a client the server side of its session is all set
+     * up: the session-open benchmark uses it so.) */
+    S_BARRIER,
+    // Client is done with its session (e.g., it's one of the clients of a multi-client benchmark).  Server carries on.
+    S_END_SESSION,
+    // Client is done.  Server shall exit.
+    S_END
+  };
+
+  Cmd m_cmd;
+  uint64_t m_arg;
+};
+
+// Outcome of parse_options().
+enum class Parse_result
+{
+  // *opts is filled out; carry on.
+  S_RUN,
+  // `--help`: usage was printed (to stdout).  main() should exit with code 0.
+  S_HELP,
+  // Bad args: the problem and usage were printed (to stderr).  main() should exit with non-zero code.
+  S_BAD_USAGE
+};
+
+/* Invoke from main() first thing; it parses command line into *opts.  Unless it returns Parse_result::S_RUN main()
+ * should exit right away: see Parse_result. */
+Parse_result parse_options(Options* opts, int argc, char const * const * argv, bool srv_else_cli);
+/* Invoke from main() right after parse_options(), before any threads are started (so that they all inherit it): pins
+ * this process to `opts.m_cpus`, if any.  If it returns `false` main() should exit with non-zero code: an error was
+ * printed. */
+bool pin_to_cpus(const Options& opts);
+// "0,2,3" for `opts.m_cpus` = {0, 2, 3}; "none" if empty.  For logging and results files.
+std::string cpus_str(const Options& opts);
 // Invoke from main() from either application to ensure it's being run directly from the expected CWD.
 void ensure_run_env(const char* argv0, bool srv_else_cli);
 // Invoke from main() to set up console and file logging.
 void setup_logging(std::optional<flow::log::Simple_ostream_logger>* std_logger,
                    std::optional<flow::log::Async_file_logger>* log_logger,
-                   int argc, char const * const * argv, bool srv_else_cli);
+                   const Options& opts, bool srv_else_cli);
 
 void ev_wait(Asio_handle* hndl_of_interest,
              bool ev_of_interest_snd_else_rcv, ipc::util::sync_io::Task_ptr&& on_active_ev_func);
@@ -0,0 +1,217 @@
+/* Flow-IPC
+ * Copyright 2023 Akamai Technologies, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in
+ * compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the License is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing
+ * permissions and limitations under the License. */
+
+/* perf_demo_compare: diffs two perf_demo result files (as written by perf_demo_cli `--results-file`; see
+ * results.hpp for the format) and flags regressions beyond a threshold.  Intended for gating an upgrade: run the
+ * benchmarks before and after, on the same machine and with the same options, then:
+ *
+ *   ./perf_demo_compare.exec before.csv after.csv [--threshold-pct=10] [--metrics=p50_usec,p99_usec,msgs_per_sec]
+ *                            [--allow-missing]
+ *
+ * For each (benchmark, config, metric) present in the baseline file whose metric is among the selected ones, it
+ * prints the baseline and candidate values and the relative change; and flags it as a regression if the candidate
+ * is worse by more than the threshold (higher for latencies; lower for throughputs).  A non-finite value (NaN,
+ * infinity) on either side is a failure too.  So is a baseline row missing from the candidate (a crashed or truncated
+ * run must not pass the gate), unless `--allow-missing` (e.g., the candidate deliberately ran fewer sizes).  Rows
+ * present only in the candidate are listed but are not failures.  Comparing nothing at all is a failure.
+ *
+ * Exit code: 0 = no failures; 1 = at least one failure (see above); 2 = bad usage, or unreadable file, or a file
+ * with more than one value for the same (benchmark, config, metric).  (`--help`: 0.)
+ *
+ * Unlike the srv/cli programs this needs neither Flow nor Flow-IPC; hence the bare-bones argument parsing. */
+
+#include "results.hpp"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+using Key = std::tuple<std::string, std::string, std::string>; // Bench, config, metric.
+
+// Reads the file; `false` (after printing why) if it can't, or if any (bench, config, metric) occurs more than once.
+static bool load(const std::string& path, Result_rows* rows)
+{
+  std::ifstream is(path);
+  std::string err_msg;
+  if (!is)
+  {
+    std::cerr << "Cannot open [" << path << "].\n";
+    return false;
+  }
+  if (!read_results_csv(is, rows, &err_msg))
+  {
+    std::cerr << "Cannot parse [" << path << "]: " << err_msg << '\n';
+    return false;
+  }
+  /* A key must identify one value; otherwise which one would we compare?  (Two result files concatenated, say, or a
+   * benchmark writing the same config twice.)  Refuse rather than guess. */
+  std::set<Key> keys;
+  for (const auto& row : *rows)
+  {
+    if (!keys.insert(Key{ row.m_bench, row.m_config, row.m_metric }).second)
+    {
+      std::cerr << "Cannot use [" << path << "]: duplicate value for " << row.m_bench << " [" << row.m_config << "] "
+                << row.m_metric << ".\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char const * const * argv)
+{
+  using std::string;
+  using std::cout;
+  using std::cerr;
+
+  const string usage = "Usage: perf_demo_compare.exec <baseline.csv> <candidate.csv> [--threshold-pct=<pct>] "
+                       "[--metrics=<metric>[,<metric>...]] [--allow-missing]\n"
+                       "  Defaults: --threshold-pct=10 --metrics=p50_usec,p99_usec,msgs_per_sec\n"
+                       "  --allow-missing: baseline values absent from the candidate are not failures\n";
+  std::vector<string> paths;
+  double threshold_pct = 10;
+  bool allow_missing = false;
+  std::set<string> metrics{ "p50_usec", "p99_usec", "msgs_per_sec" };
+  for (int idx = 1; idx != argc; ++idx)
+  {
+    const string arg = argv[idx];
+    if (arg.rfind("--threshold-pct=", 0) == 0)
+    {
+      std::istringstream is(arg.substr(arg.find('=') + 1));
+      if (!((is >> threshold_pct) && is.eof() && (threshold_pct >= 0)))
+      {
+        cerr << "Bad threshold in [" << arg << "].\n" << usage;
+        return 2;
+      }
+    }
+    else if (arg.rfind("--metrics=", 0) == 0)
+    {
+      metrics.clear();
+      std::istringstream is(arg.substr(arg.find('=') + 1));
+      for (string metric; std::getline(is, metric, ','); )
+      {
+        metrics.insert(metric);
+      }
+    }
+    else if (arg == "--allow-missing")
+    {
+      allow_missing = true;
+    }
+    else if ((arg == "--help") || (arg == "-h"))
+    {
+      cout << usage;
+      return 0;
+    }
+    else if (arg.rfind("--", 0) == 0)
+    {
+      cerr << "Unknown option [" << arg << "].\n" << usage;
+      return 2;
+    }
+    else
+    {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2)
+  {
+    cerr << usage;
+    return 2;
+  }
+
+  Result_rows base_rows;
+  Result_rows cand_rows;
+  if (!(load(paths[0], &base_rows) && load(paths[1], &cand_rows)))
+  {
+    return 2;
+  }
+
+  std::map<Key, double> cand_vals;
+  for (const auto& row : cand_rows)
+  {
+    cand_vals.emplace(Key{ row.m_bench, row.m_config, row.m_metric }, row.m_value);
+  }
+
+  size_t n_compared = 0;
+  size_t n_regressions = 0;
+  size_t n_missing = 0;
+  size_t n_bad_values = 0;
+  cout << std::fixed << std::setprecision(2);
+  for (const auto& row : base_rows)
+  {
+    if (metrics.count(row.m_metric) == 0)
+    {
+      continue;
+    }
+    // else
+    const auto cand_it = cand_vals.find(Key{ row.m_bench, row.m_config, row.m_metric });
+    if (cand_it == cand_vals.end())
+    {
+      n_missing += !allow_missing;
+      cout << (allow_missing ? "ONLY-IN-BASELINE  " : "MISSING           ")
+           << row.m_bench << " [" << row.m_config << "] " << row.m_metric << '\n';
+      continue;
+    }
+    // else
+    const double cand_val = cand_it->second;
+    cand_vals.erase(cand_it);
+    if (!(std::isfinite(row.m_value) && std::isfinite(cand_val)))
+    {
+      ++n_bad_values;
+      cout << "BAD-VALUE         " << row.m_bench << " [" << row.m_config << "] " << row.m_metric << ": "
+           << row.m_value << " -> " << cand_val << '\n';
+      continue;
+    }
+    // else
+    ++n_compared;
+
+    /* Relative change, signed such that positive = worse.  A zero baseline can only get worse (or stay at 0);
+     * treat any worsening from 0 as infinitely bad. */
+    const double worse_by = metric_higher_is_better(row.m_metric) ? (row.m_value - cand_val) : (cand_val - row.m_value);
+    const double worse_by_pct = (row.m_value == 0) ? ((worse_by > 0) ? std::numeric_limits<double>::infinity() : 0)
+                                                   : (worse_by / row.m_value * 100);
+    const bool regression = worse_by_pct > threshold_pct;
+    n_regressions += regression;
+
+    cout << (regression ? "REGRESSION        " : ((worse_by_pct < -threshold_pct) ? "IMPROVEMENT       "
+                                                                                   : "ok                "))
+         << row.m_bench << " [" << row.m_config << "] " << row.m_metric << ": "
+         << row.m_value << " -> " << cand_val << " (worse by " << worse_by_pct << "%)\n";
+  }
+  for (const auto& cand_val : cand_vals)
+  {
+    if (metrics.count(std::get<2>(cand_val.first)) != 0)
+    {
+      cout << "ONLY-IN-CANDIDATE " << std::get<0>(cand_val.first) << " [" << std::get<1>(cand_val.first) << "] "
+           << std::get<2>(cand_val.first) << '\n';
+    }
+  }
+
+  cout << "Compared [" << n_compared << "] values; [" << n_regressions << "] regression(s) beyond "
+       << "[" << threshold_pct << "%]; [" << n_missing << "] missing from candidate; "
+       << "[" << n_bad_values << "] non-finite.\n";
+  if (n_compared == 0)
+  {
+    cout << "Nothing was compared: wrong files or --metrics?\n";
+    return 1;
+  }
+  return ((n_regressions == 0) && (n_missing == 0) && (n_bad_values == 0)) ? 0 : 1;
+} // main()
@@ -19,124 +19,2345 @@
  *
  * As is typical in these client-server test/demo programs, the 2 programs mirror each other.  So the comments
  * are generally in main_srv.cpp, and we keep it light here in main_cli.cpp; except where there's our-side-specific
- * stuff.  Please refer to the other file, as you go through this one. */
+ * stuff.  Please refer to the other file, as you go through this one.
+ *
+ * One thing that is client-specific: we drive the run.  The server prepares and sends whatever we ask for (via
+ * Ctl_msg over the raw channel); we decide which payload size(s) to benchmark and how many times.  We also report
+ * the results: on the console; and optionally (`--results-file`) in machine-readable form, so that two runs can be
+ * compared by perf_demo_compare (see results.hpp and compare.cpp).
+ *
+ * The multi-client benchmark is the exception to "one client program, one session": there we spawn K more processes
+ * of this same program (see run_multi_clients()), each of which opens its own session and generates load; we
+ * merely gather and report their results. */
+
+#include "common.hpp"
+#include <ipc/transport/native_socket_stream_acceptor.hpp>
+#include <ipc/transport/native_socket_stream.hpp>
+#include <ipc/transport/posix_mq_handle.hpp>
+#include <ipc/session/detail/session_shared_name.hpp>
+#include <flow/perf/checkpt_timer.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <type_traits>
+
+// Results of a small-message benchmark over one structured channel, in one mode (ping-pong or streaming).
+struct Small_msgs_result
+{
+  // Messages (ping-pong: round trips) per second over all timed batches.
+  double m_msgs_per_sec = 0;
+  // Ping-pong: each round trip's RTT.  Streaming: each timed batch's duration divided by its message count.
+  Latency_stats m_lat;
+  // Sum of the timed batches' durations.
+  flow::Fine_duration m_timed_total = flow::Fine_duration::zero();
+  // Context switches during the timed batches (see process_ctx_switches()), per message.
+  double m_ctx_switches_per_msg = 0;
+  // With `--counters`: counters over the timed batches, per message.
+  Counter_values m_counters;
+  // Each timed batch's duration, in order (see Options::m_report_repeats).
+  std::vector<flow::Fine_duration> m_batch_durs;
+  // With `--spin-usec`: the event loop's spinning (see run_asio()) over the whole benchmark, warmup included.
+  Spin_stats m_spin;
+};
+
+// Results of the multi-client benchmark with a given number of clients.
+struct Multi_client_result
+{
+  unsigned int m_n_clients;
+  // Round trips per second, all clients together.
+  double m_msgs_per_sec;
+  // RTTs of all clients together.
+  Latency_stats m_lat;
+};
+
+// Timings of open/close cycles of sessions of one Transport.  (See time_open_cycles().)
+struct Open_cycles_result
+{
+  Latency_stats m_session_open;
+  Latency_stats m_channel_open;
+  Latency_stats m_session_close;
+};
+
+/* Results of the session-open benchmark.  (See run_open().)  m_main: sessions like the one main() uses (S_SOCKET; all
+ * S_N_CHANS init-channels).  m_by_transport: sessions of S_SOCKET_HNDL, S_POSIX_MQ_HNDL, S_BIPC_MQ_HNDL
+ * (S_N_TRANSPORT_CHANS init-channels each); the differences between those are what MQ-backed channels cost, measured.
+ * Then some isolated primitives: timed on their own, not as part of any session open; for reference. */
+struct Open_result
+{
+  Open_cycles_result m_main;
+  std::vector<std::pair<Transport, Open_cycles_result>> m_by_transport;
+  Latency_stats m_socket_connect;
+  // SHM-classic only (see run_open()); with SHM-jemalloc no samples.
+  Latency_stats m_shm_pool_create_map;
+  Latency_stats m_posix_mq_create;
+  Latency_stats m_bipc_mq_create;
+};
+
+// Results of the transport-matrix benchmark for one transport.
+struct Transport_result
+{
+  Transport m_transport;
+  Small_msgs_result m_ping_pong;
+  Small_msgs_result m_stream;
+};
+
+/* The async-I/O-API counterpart of Channel_struc; and the 2 flavors of the stream underlying (in our sessions)
+ * Channel_raw.  Used in the async-I/O-vs-sync_io benchmark only: see run_async(). */
+using Channel_struc_async = Client_session::Structured_channel<perf_demo::schema::Body>;
+using Sock_sync_io = ipc::transport::sync_io::Native_socket_stream;
+using Sock_async = ipc::transport::Native_socket_stream;
+
+// Results of the async-I/O-vs-sync_io benchmark for one kind of channel via one API (or API variant).
+struct Async_result
+{
+  // "structured" or "raw".
+  std::string m_chan_name;
+  // "sync_io" or an async-I/O variant.
+  std::string m_api_name;
+  // For results file.
+  std::string m_config_name;
+  Small_msgs_result m_ping_pong;
+};
+
+/* Results of the SHM-native STL benchmark for one container kind, size and arena.  The build and lend are timed by
+ * the server; the rest by us.  See run_stl_one(). */
+struct Stl_result
+{
+  // "vector", "map" or "string".
+  std::string m_kind_name;
+  size_t m_n_elems = 0;
+  // "session_shm" or "app_shm".
+  std::string m_arena_name;
+  Latency_stats m_build;
+  Latency_stats m_lend;
+  // Handle transmission: RTT minus server's processing time.
+  Latency_stats m_xmit;
+  Latency_stats m_borrow;
+  Latency_stats m_traverse;
+  // Request to end of traversal.
+  Latency_stats m_total;
+  // With `--counters`: counters over the timed iterations (on our side only), per iteration.
+  Counter_values m_counters;
+  // Each timed iteration's total, in order (see Options::m_report_repeats).
+  std::vector<flow::Fine_duration> m_total_samples;
+};
+
+template<typename Channel_raw_t>
+void await_ctl(Channel_raw_t* chan_ptr, Ctl_msg* ctl);
+size_t prep_capnp(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr, size_t sz);
+void end_run(Channel_raw* chan_ptr);
+/* If `lat_samples` is not null, the raw samples behind the returned `m_lat` are also stored there (which is
+ * useful when combining results of several runs). */
+template<typename Channel_struc_t, typename Channel_raw_t>
+Small_msgs_result run_small_msgs(flow::log::Logger* logger_ptr, Channel_struc_t* chan_ptr, Channel_raw_t* chan_raw_ptr,
+                                 const Options& opts, bool stream_else_ping_pong,
+                                 std::vector<flow::Fine_duration>* lat_samples = nullptr);
+Multi_client_result run_multi_clients(flow::log::Logger* logger_ptr, const char* argv0, const Options& opts,
+                                      unsigned int n_clients);
+void run_load_child(flow::log::Logger* logger_ptr, Channel_struc* chan_ptr, Channel_raw* chan_raw_ptr,
+                    const Options& opts);
+Open_result run_open(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts);
+template<Transport S_TRANSPORT>
+Open_cycles_result time_open_cycles(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr,
+                                    const Options& opts, size_t n_init_chans);
+Transport_result run_transport(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts,
+                               Transport transport);
+template<Transport S_TRANSPORT>
+Transport_result run_transport(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts);
+template<typename Mq>
+std::vector<flow::Fine_duration> time_mq_create(flow::log::Logger* ipc_logger_ptr,
+                                               const ipc::util::Shared_name& name, const Options& opts);
+std::vector<Async_result> run_async(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr,
+                                    Client_session* session_ptr, Client_session::Channels* chans_ptr,
+                                    Channel_struc* chan_struc_ptr, Channel_raw* chan_raw_ptr, const Options& opts);
+std::vector<Stl_result> run_stl(flow::log::Logger* logger_ptr, Client_session* session_ptr, Channel_struc* chan_ptr,
+                                const Options& opts);
+template<typename Container>
+Stl_result run_stl_one(flow::log::Logger* logger_ptr, Client_session* session_ptr, Channel_struc* chan_ptr,
+                       const Options& opts, perf_demo::schema::GetStlReq::Kind kind, size_t n_elems,
+                       bool app_else_session_shm);
+Small_msgs_result run_small_msgs_async_io(flow::log::Logger* logger_ptr, Channel_struc_async* chan_ptr,
+                                          Channel_raw* chan_raw_ptr, const Options& opts, bool hop);
+template<typename Sock>
+Small_msgs_result run_echo(flow::log::Logger* logger_ptr, Sock* sock_ptr, const Options& opts, bool hop);
+std::vector<flow::Fine_duration> time_shm_pool_create_map(const std::string& name, const Options& opts);
+std::vector<flow::Fine_duration> run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan,
+                                                    const Options& opts);
+std::vector<flow::Fine_duration> run_capnp_zero_cpy(flow::log::Logger* logger_ptr, Channel_struc* chan,
+                                                    const Options& opts);
+void verify_rsp(const perf_demo::schema::GetCacheRsp::Reader& rsp_root);
+// g_asio.run(); or, with `--spin-usec`, its spin-then-block equivalent: see run_event_loop().
+void run_asio();
+void prefault_shm(flow::log::Logger* logger_ptr, Client_session* session_ptr, Channel_struc* chan_ptr,
+                  const Options& opts);
+// E.g., "[12.3 / 11.9 / 12.0] usec": the given samples, in order.  See Options::m_report_repeats.
+std::string repeats_str(const std::vector<flow::Fine_duration>& samples);
+std::vector<size_t> sweep_sizes(const Options& opts);
+
+using Timer = flow::perf::Checkpointing_timer;
+using Clock_type = flow::perf::Clock_type;
+
+static Task_engine g_asio;
+/* Byte count inside the transmitted data.  Server reports it when preparing the data for a given payload size;
+ * each benchmark ensures it got same-sized data too. */
+static size_t g_total_sz = 0;
+/* Hardware/OS counters (`--counters`).  Each benchmark start()s and stop()s it around its timed sections; then the
+ * caller take()s the result.  (If not open()ed, that's all no-ops.) */
+static Perf_counters g_counters;
+/* Spin-then-block event loop (`--spin-usec`): the budget, set from Options at startup; and the outcomes so far.  See
+ * run_asio(). */
+static unsigned int g_spin_usec = 0;
+static Spin_stats g_spin_stats;
+
+int main(int argc, char const * const * argv)
+{
+  using Session = Client_session;
+  using flow::log::Simple_ostream_logger;
+  using flow::log::Async_file_logger;
+  using flow::Flow_log_component;
+  using flow::util::ceil_div;
+  using boost::promise;
+  using boost::chrono::microseconds;
+  using boost::chrono::round;
+  using std::exception;
+  using std::optional;
+  using std::vector;
+
+  Options opts;
+  const auto parse_result = parse_options(&opts, argc, argv, false);
+  if (parse_result != Parse_result::S_RUN)
+  {
+    return (parse_result == Parse_result::S_HELP) ? 0 : 1;
+  }
+  if (!pin_to_cpus(opts))
+  {
+    return 1;
+  }
+
+  /* Set up logging within this function.  We could easily just use `cout` and `cerr` instead, but this
+   * Flow stuff will give us time stamps and such for free, so why not?  Normally, one derives from
+   * Log_context to do this very trivially, but we just have the one function, main(), so far so: */
+  optional<Simple_ostream_logger> std_logger;
+  optional<Async_file_logger> log_logger;
+  setup_logging(&std_logger, &log_logger, opts, false);
+  FLOW_LOG_SET_CONTEXT(&(*std_logger), Flow_log_component::S_UNCAT);
+  FLOW_LOG_INFO("Pinned to CPUs: [" << cpus_str(opts) << "].");
+
+#if JEM_ELSE_CLASSIC
+  ipc::session::shm::arena_lend::Borrower_shm_pool_collection_repository_singleton::get_instance()
+    .set_logger(&(*log_logger));
+#endif
+
+  g_spin_usec = opts.m_spin_usec;
+  // Before the session (and its threads) is around; see Perf_counters::open().
+  if (opts.m_counters)
+  {
+    g_counters.open(&(*std_logger));
+  }
+
+  try
+  {
+    ensure_run_env(argv[0], false);
+
+    Session session(&(*log_logger),
+                    CLI_APPS.find(CLI_NAME)->second,
+                    SRV_APPS.find(SRV_NAME)->second, [](const Error_code&) {});
+
+    FLOW_LOG_INFO("Session-client attempting to open session against session-server; "
+                  "it'll either succeed or fail very soon.");
+
+    Session::Channels chans;
+    session.sync_connect(session.mdt_builder(), nullptr, nullptr, &chans); // Let it throw on error.
+    FLOW_LOG_INFO("Session/channels opened.");
+
+    assert(chans.size() == S_N_CHANS); // Server shall offer us these.  (We could also ask for some above, but won't.)
+
+    auto& chan_raw = chans[S_CHAN_RAW]; // Binary channel for raw-ish tests (and Ctl_msg commands).
+    Channel_struc chan_struc(&(*log_logger), std::move(chans[S_CHAN_STRUC_SESSION_SHM]), // Session-SHM-backed.
+                             ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM, &session);
+    // The rest are for the small-message benchmarks only.
+    Channel_struc_heap chan_struc_heap(&(*log_logger), std::move(chans[S_CHAN_STRUC_HEAP]),
+                                       ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_HEAP,
+                                       session.session_token());
+#if JEM_ELSE_CLASSIC
+    /* SHM-jemalloc does not let a session-client allocate in app-SHM (only the session-server app has an app-SHM
+     * arena it can lend out); so our (small, anyway) requests on this channel are session-SHM-backed.  The server's
+     * responses are app-SHM-backed though. */
+    Channel_struc chan_struc_app(&(*log_logger), std::move(chans[S_CHAN_STRUC_APP_SHM]),
+                                 ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM, &session);
+#else
+    Channel_struc chan_struc_app(&(*log_logger), std::move(chans[S_CHAN_STRUC_APP_SHM]),
+                                 ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_APP_SHM, &session);
+#endif
+
+    /* The channels are used throughout (possibly for many benchmark runs), so start them up once here.
+     * (See main_srv.cpp for notes on this sync_io-pattern business.) */
+    chan_raw.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+    chan_raw.start_send_blob_ops(ev_wait);
+    chan_raw.start_receive_blob_ops(ev_wait);
+    const auto start_struc = [](auto& chan)
+    {
+      chan.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+      chan.start_ops(ev_wait);
+      chan.start_and_poll([](const Error_code&) {});
+    };
+    start_struc(chan_struc);
+    start_struc(chan_struc_heap);
+    start_struc(chan_struc_app);
+
+    if (!opts.m_load_child_out.empty())
+    {
+      // We're one of the clients spawned by run_multi_clients().  Do our part; that's all.
+      run_load_child(&(*std_logger), &chan_struc, &chan_raw, opts);
+      FLOW_LOG_INFO("Exiting.");
+      return 0;
+    }
+
+    /* Record the things that affect the numbers but are not part of any one benchmark's config; so that results are
+     * comparable between runs and machines.  (The server logs its own pinning.) */
+    FLOW_LOG_INFO("Run setup: pinned to CPUs [" << cpus_str(opts) << "] (of [" << std::thread::hardware_concurrency()
+                  << "]); [" << opts.m_n_warmup << "] warmup + [" << opts.m_n_repeats << "] timed iterations per "
+                  "benchmark; SHM pre-faulted: [" << opts.m_prefault_mi << " MiB] (0 = no); event loop spins up to "
+                  "[" << opts.m_spin_usec << " usec] (0 = no); session-open benchmark SHM pool: "
+                  "[" << opts.m_open_shm_pool_mi << " MiB].");
+    if (opts.m_prefault_mi != 0)
+    {
+      prefault_shm(&(*std_logger), &session, &chan_struc, opts);
+    }
+
+    /* Without --sweep: just the one payload size the server prepared at startup (that's what requested size 0
+     * means); and by default just one cold (no warmup) iteration of each benchmark.  With --sweep: the range of
+     * sizes; and by default some warmup iterations followed by enough timed ones to get a distribution. */
+    struct Result
+    {
+      size_t m_data_sz;
+      Latency_stats m_raw;
+      Latency_stats m_zcp;
+      // With `--counters`: per iteration.
+      Counter_values m_raw_counters;
+      Counter_values m_zcp_counters;
+      // The RTTs behind m_raw and m_zcp, in order (see Options::m_report_repeats).
+      vector<flow::Fine_duration> m_raw_samples;
+      vector<flow::Fine_duration> m_zcp_samples;
+    };
+    vector<Result> results;
+    if (opts.m_bench_capnp)
+    {
+      for (const auto sz : opts.m_sweep ? sweep_sizes(opts) : vector<size_t>{ 0 })
+      {
+        const auto data_sz = prep_capnp(&(*std_logger), &chan_raw, sz);
+        /* The server rounds to whole file parts; so close small swept sizes can come out the same.  Same size =>
+         * same benchmark; and the results file must have one value per (benchmark, config, metric). */
+        if (std::find_if(results.begin(), results.end(),
+                         [&](const Result& result) { return result.m_data_sz == data_sz; }) != results.end())
+        {
+          FLOW_LOG_INFO("Size [" << data_sz << " bytes] already done; skipping.");
+          continue;
+        }
+        // Benchmark 1.  capnp data transmission without Flow-IPC zero-copy.
+        auto raw_samples = run_capnp_over_raw(&(*std_logger), &chan_raw, opts);
+        const auto raw_counters = g_counters.take().per(opts.m_n_repeats);
+        // Benchmark 2.  Same but with it.
+        auto zcp_samples = run_capnp_zero_cpy(&(*std_logger), &chan_struc, opts);
+        const auto zcp_counters = g_counters.take().per(opts.m_n_repeats);
+
+        const Latency_stats raw_stats(raw_samples);
+        const Latency_stats zcp_stats(zcp_samples);
+        FLOW_LOG_INFO("Size [" << data_sz << " bytes]: raw: " << raw_stats << "; zero-copy: " << zcp_stats << '.');
+        results.push_back({ data_sz, raw_stats, zcp_stats, raw_counters, zcp_counters,
+                            std::move(raw_samples), std::move(zcp_samples) });
+      }
+    }
+
+    /* Small-message benchmarks: the fixed per-message cost (as opposed to the per-byte cost the capnp benchmarks
+     * are mostly about) of each serialization type; as ping-pong (latency-bound) and one-way streaming
+     * (throughput-bound). */
+    struct Small_result
+    {
+      std::string m_name;
+      std::string m_config_name; // For results file.
+      Small_msgs_result m_ping_pong;
+      Small_msgs_result m_stream;
+    };
+    vector<Small_result> small_results;
+    if (opts.m_bench_small)
+    {
+      const auto run_both = [&](const char* name, const char* config_name, auto& chan)
+      {
+        FLOW_LOG_INFO("Small messages via [" << name << "]-backed structured channel: ");
+        const auto ping_pong = run_small_msgs(&(*std_logger), &chan, &chan_raw, opts, false);
+        const auto stream = run_small_msgs(&(*std_logger), &chan, &chan_raw, opts, true);
+        small_results.push_back({ name, config_name, ping_pong, stream });
+      };
+      run_both("heap", "heap", chan_struc_heap);
+      run_both("session-SHM", "session_shm", chan_struc);
+      run_both("app-SHM", "app_shm", chan_struc_app);
+    }
+
+    /* Multi-client benchmark: the server's behavior (and that of its SHM arenas and event loop) under concurrent
+     * load from K sessions, as K grows.  We ourselves (and our session) sit it out; the K clients are other processes
+     * (running this same program). */
+    vector<Multi_client_result> multi_results;
+    if (opts.m_bench_multi)
+    {
+      for (const auto n_clients : opts.m_n_clients_list)
+      {
+        multi_results.push_back(run_multi_clients(&(*std_logger), argv[0], opts, n_clients));
+      }
+    }
+
+    /* Session-open benchmark: the cost of setting up (and tearing down) a session and a channel, which matters to
+     * applications that do so often (e.g., short-lived client processes) and for start-up latency. */
+    optional<Open_result> open_result;
+    if (opts.m_bench_open)
+    {
+      open_result = run_open(&(*std_logger), &(*log_logger), opts);
+    }
+
+    /* Transport-matrix benchmark: the same small-message traffic as above (over the session-SHM-backed channel only)
+     * in sessions of each of the chosen transports; so as to pick the fastest pipe type for each kind of traffic. */
+    vector<Transport_result> transport_results;
+    if (opts.m_bench_transports)
+    {
+      for (const auto transport : opts.m_transports)
+      {
+        transport_results.push_back(run_transport(&(*std_logger), &(*log_logger), opts, transport));
+      }
+    }
+
+    /* SHM-native STL benchmark: sharing C++ data structures (as opposed to capnp messages) via SHM: the server
+     * builds them directly in SHM and lends them to us; we borrow and read them in place. */
+    vector<Stl_result> stl_results;
+    if (opts.m_bench_stl)
+    {
+      stl_results = run_stl(&(*std_logger), &session, &chan_struc, opts);
+    }
+
+    /* Async-I/O-vs-sync_io benchmark: what the convenience of the async-I/O API (no event loop integration needed;
+     * handlers are invoked from a library thread) costs per message, compared to the sync_io API used everywhere
+     * else in this program; in latency and in context switches. */
+    vector<Async_result> async_results;
+    if (opts.m_bench_async)
+    {
+      async_results = run_async(&(*std_logger), &(*log_logger), &session, &chans, &chan_struc, &chan_raw, opts);
+    }
+
+    end_run(&chan_raw);
+
+    if (opts.m_bench_capnp && (!opts.m_sweep))
+    {
+      /* They already printed detailed timing info; now let's summarize the total results.  As you can see it
+       * just prints b1's RTT, b2's RTT, and the ratio; while reminding how much data was transmitted.
+       * (Ultimately b2's RTT will always be about the same and small; whereas b1's involves a bunch of copying
+       * into/out of tranport and hence will be proportional to data size.)  If there were several timed repeats,
+       * then it's the median RTT of each.
+       *
+       * The only subtlety is that we coarsen the RTT to be a multiple of 100us, rounding up.  Reason: It's not
+       * bulletproof, and it might be different on slower machines, but for now I've found this to be decent in
+       * practice: There's quite a bit of variation for a small message's RTT, maybe +/- 50us; and the total tends to
+       * be, if rounded to nearest 100us, at least 100us.  Furthermore, if sending small messages, sometimes there are
+       * paradoxical-ish results like b1-RTT/b2-RTT < 1, but really they're both around 100us, so it's more like 1.
+       * Once total_sz is increased beyond 10k-or-so, this stuff falls away and the coarsening to 100us-multiples
+       * doesn't really matter anyway and is easier to read.
+       *
+       * Maybe that's silliness.  In any case the un-coarsened detailed results are printed by run_*(); here
+       * we're summarizing.  @todo Revisit.  (The --sweep summary below does not coarsen; with warmup and repeats
+       * the jitter is visible in the distribution instead.) */
+
+      const auto& result = results.front();
+      const auto raw_rtt = ceil_div(round<microseconds>(result.m_raw.m_p50).count(), microseconds::rep(100)) * 100;
+      const auto zcp_rtt = ceil_div(round<microseconds>(result.m_zcp.m_p50).count(), microseconds::rep(100)) * 100;
+
+      FLOW_LOG_INFO("Benchmark summary (rounded-up to 100-usec multiples): ");
+      FLOW_LOG_INFO("Transmission of ~[" << (result.m_data_sz / 1024) << " ki] of Cap'n Proto structured data: ");
+      FLOW_LOG_INFO("Via raw-local-stream-socket: RTT = [" << raw_rtt << " usec].");
+      FLOW_LOG_INFO("Via-zero-copy-Flow-IPC-channel ("
+#if JEM_ELSE_CLASSIC
+                    "SHM-jemalloc-backed"
+#else
+                    "SHM-classic-backed"
+#endif
+                    "): RTT = [" << zcp_rtt << " usec].");
+      FLOW_LOG_INFO("Ratio = [" << float(raw_rtt) / float(zcp_rtt) << "].");
+      if (opts.m_report_repeats)
+      {
+        FLOW_LOG_INFO("Each timed iteration's RTT: raw: " << repeats_str(result.m_raw_samples) << '.');
+        FLOW_LOG_INFO("Each timed iteration's RTT: zero-copy: " << repeats_str(result.m_zcp_samples) << '.');
+      }
+      if (g_counters.is_open())
+      {
+        FLOW_LOG_INFO("Counters per iteration: raw: " << result.m_raw_counters << '.');
+        FLOW_LOG_INFO("Counters per iteration: zero-copy: " << result.m_zcp_counters << '.');
+      }
+    }
+    else if (opts.m_bench_capnp)
+    {
+      /* Payload-size sweep summary: one line per size; then the crossover point, namely the smallest size
+       * from which on (inclusive, all the way to the largest size) zero-copy's median RTT beats raw's. */
+      FLOW_LOG_INFO("Benchmark summary (payload-size sweep; [" << opts.m_n_warmup << "] warmup + "
+                    "[" << opts.m_n_repeats << "] timed iterations per size per path; "
+#if JEM_ELSE_CLASSIC
+                    "zero-copy is SHM-jemalloc-backed"
+#else
+                    "zero-copy is SHM-classic-backed"
+#endif
+                    "): ");
+      optional<size_t> crossover_sz;
+      for (const auto& result : results)
+      {
+        FLOW_LOG_INFO("[" << result.m_data_sz << " bytes]: ");
+        FLOW_LOG_INFO("  Via raw-local-stream-socket:        RTT " << result.m_raw);
+        FLOW_LOG_INFO("  Via-zero-copy-Flow-IPC-channel:     RTT " << result.m_zcp);
+        FLOW_LOG_INFO("  Ratio (p50) = [" << (to_usec(result.m_raw.m_p50) / to_usec(result.m_zcp.m_p50)) << "].");
+        if (opts.m_report_repeats)
+        {
+          FLOW_LOG_INFO("  Each timed iteration's RTT: raw:       " << repeats_str(result.m_raw_samples));
+          FLOW_LOG_INFO("  Each timed iteration's RTT: zero-copy: " << repeats_str(result.m_zcp_samples));
+        }
+        if (g_counters.is_open())
+        {
+          FLOW_LOG_INFO("  Counters per iteration: raw:       " << result.m_raw_counters);
+          FLOW_LOG_INFO("  Counters per iteration: zero-copy: " << result.m_zcp_counters);
+        }
+
+        if (result.m_zcp.m_p50 < result.m_raw.m_p50)
+        {
+          if (!crossover_sz)
+          {
+            crossover_sz = result.m_data_sz;
+          }
+        }
+        else
+        {
+          crossover_sz.reset();
+        }
+      }
+
+      if (crossover_sz)
+      {
+        FLOW_LOG_INFO("Crossover: zero-copy median RTT beats raw's at all swept sizes >= [" << *crossover_sz << " "
+                      "bytes].");
+      }
+      else
+      {
+        FLOW_LOG_INFO("Crossover: zero-copy median RTT does not beat raw's at the largest swept size; "
+                      "try a larger --sweep-max.");
+      }
+    }
+
+    if (opts.m_bench_small)
+    {
+      FLOW_LOG_INFO("Small-message benchmark summary ([" << opts.m_small_n_msgs << "] messages per batch; "
+                    "[" << opts.m_n_warmup << "] warmup + [" << opts.m_n_repeats << "] timed batches per path; "
+#if JEM_ELSE_CLASSIC
+                    "SHM is SHM-jemalloc"
+#else
+                    "SHM is SHM-classic"
+#endif
+                    "): ");
+      for (const auto& result : small_results)
+      {
+        FLOW_LOG_INFO("[" << result.m_name << "]-backed structured channel: ");
+        FLOW_LOG_INFO("  Ping-pong: [" << std::llround(result.m_ping_pong.m_msgs_per_sec) << "] round trips/sec; "
+                      "RTT " << result.m_ping_pong.m_lat);
+        if (g_counters.is_open())
+        {
+          FLOW_LOG_INFO("    Counters per round trip: " << result.m_ping_pong.m_counters);
+        }
+        if (opts.m_report_repeats)
+        {
+          FLOW_LOG_INFO("    Each timed batch: " << repeats_str(result.m_ping_pong.m_batch_durs));
+        }
+        if (opts.m_spin_usec != 0)
+        {
+          FLOW_LOG_INFO("    Event loop: " << result.m_ping_pong.m_spin);
+        }
+        FLOW_LOG_INFO("  Streaming: [" << std::llround(result.m_stream.m_msgs_per_sec) << "] msgs/sec; "
+                      "per-message (batch time / batch size) " << result.m_stream.m_lat);
+        if (g_counters.is_open())
+        {
+          FLOW_LOG_INFO("    Counters per message: " << result.m_stream.m_counters);
+        }
+        if (opts.m_report_repeats)
+        {
+          FLOW_LOG_INFO("    Each timed batch: " << repeats_str(result.m_stream.m_batch_durs));
+        }
+        if (opts.m_spin_usec != 0)
+        {
+          FLOW_LOG_INFO("    Event loop: " << result.m_stream.m_spin);
+        }
+      }
+    }
+
+    if (opts.m_bench_multi)
+    {
+      FLOW_LOG_INFO("Multi-client benchmark summary (small-message ping-pong over session-SHM-backed channel; "
+                    "per client: [" << opts.m_small_n_msgs << "] round trips per batch, "
+                    "[" << opts.m_n_warmup << "] warmup + [" << opts.m_n_repeats << "] timed batches; "
+#if JEM_ELSE_CLASSIC
+                    "SHM-jemalloc"
+#else
+                    "SHM-classic"
+#endif
+                    "): ");
+      for (const auto& result : multi_results)
+      {
+        FLOW_LOG_INFO("  [" << result.m_n_clients << "] clients: "
+                      "aggregate [" << std::llround(result.m_msgs_per_sec) << "] round trips/sec; "
+                      "RTT " << result.m_lat);
+      }
+    }
+
+    if (open_result)
+    {
+      const auto& result = *open_result;
+      FLOW_LOG_INFO("Session-open benchmark summary ([" << opts.m_n_warmup << "] warmup + "
+                    "[" << opts.m_n_repeats << "] timed open/close cycles; "
+#if JEM_ELSE_CLASSIC
+                    "SHM-jemalloc"
+#else
+                    "SHM-classic"
+#endif
+                    "): ");
+      FLOW_LOG_INFO("  Session open (sync_connect(), incl. [" << size_t(S_N_CHANS) << "] init-channels and SHM setup): "
+                    << result.m_main.m_session_open);
+      FLOW_LOG_INFO("  Channel open (open_channel()):                        " << result.m_main.m_channel_open);
+      FLOW_LOG_INFO("  Session close (channels and session destroyed):      " << result.m_main.m_session_close);
+      /* The same, by transport.  These sessions differ only in their channels' pipes: each channel has a socket (for
+       * native handles); the MQ ones also have 2 MQs (one per direction).  So the difference in session-open (and
+       * channel-open) time is what those MQs cost, all in: creation by the server, opening by us, and their part of
+       * the session protocol. */
+      FLOW_LOG_INFO("  By transport ([" << size_t(S_N_TRANSPORT_CHANS) << "] init-channels each): ");
+      const Open_cycles_result* socket_only = nullptr;
+      for (const auto& transport_result : result.m_by_transport)
+      {
+        const auto& cycles = transport_result.second;
+        FLOW_LOG_INFO("    [" << transport_name(transport_result.first) << "]: "
+                      "session open " << cycles.m_session_open << "; channel open " << cycles.m_channel_open << "; "
+                      "session close " << cycles.m_session_close);
+        if (transport_mq_type(transport_result.first) == ipc::session::schema::MqType::NONE)
+        {
+          socket_only = &cycles;
+        }
+        else if (socket_only)
+        {
+          FLOW_LOG_INFO("      MQ cost vs. [" << transport_name(Transport::S_SOCKET_HNDL) << "] (medians): "
+                        "session open "
+                        "[" << (to_usec(cycles.m_session_open.m_p50) - to_usec(socket_only->m_session_open.m_p50))
+                        << "] usec (for [" << (2 * size_t(S_N_TRANSPORT_CHANS)) << "] MQs); channel open "
+                        "[" << (to_usec(cycles.m_channel_open.m_p50) - to_usec(socket_only->m_channel_open.m_p50))
+                        << "] usec (for 2 MQs).");
+        }
+      }
+      /* These were timed on their own, so they do not add up to anything in particular; but they do show what the
+       * building blocks of a session open cost.  A session open includes 1 socket connect (the session master
+       * channel; the channels' sockets are socket-pairs, not connects); and, with SHM-classic, the session SHM pool
+       * is created (by the server) and mapped (by both sides). */
+      FLOW_LOG_INFO("  Isolated primitives (for reference; not part of the above): ");
+      FLOW_LOG_INFO("    Local-stream-socket connect:           " << result.m_socket_connect);
+#if JEM_ELSE_CLASSIC
+      FLOW_LOG_INFO("    SHM pool create+map:                    n/a (SHM-jemalloc creates pools on demand)");
+#else
+      FLOW_LOG_INFO("    SHM pool create+map ([" << opts.m_open_shm_pool_mi << " Mi]):  "
+                    << result.m_shm_pool_create_map);
+#endif
+      FLOW_LOG_INFO("    POSIX MQ create:                       " << result.m_posix_mq_create);
+      FLOW_LOG_INFO("    bipc MQ create:                        " << result.m_bipc_mq_create);
+    }
+
+    if (opts.m_bench_transports)
+    {
+      FLOW_LOG_INFO("Transport-matrix benchmark summary (small messages over session-SHM-backed structured channel; "
+                    "[" << opts.m_small_n_msgs << "] messages per batch; "
+                    "[" << opts.m_n_warmup << "] warmup + [" << opts.m_n_repeats << "] timed batches per transport; "
+#if JEM_ELSE_CLASSIC
+                    "SHM-jemalloc"
+#else
+                    "SHM-classic"
+#endif
+                    "): ");
+      const Transport_result* best_ping_pong = nullptr;
+      const Transport_result* best_stream = nullptr;
+      for (const auto& result : transport_results)
+      {
+        FLOW_LOG_INFO("[" << transport_name(result.m_transport) << "]: ");
+        FLOW_LOG_INFO("  Ping-pong: [" << std::llround(result.m_ping_pong.m_msgs_per_sec) << "] round trips/sec; "
+                      "RTT " << result.m_ping_pong.m_lat);
+        if (g_counters.is_open())
+        {
+          FLOW_LOG_INFO("    Counters per round trip: " << result.m_ping_pong.m_counters);
+        }
+        if (opts.m_report_repeats)
+        {
+          FLOW_LOG_INFO("    Each timed batch: " << repeats_str(result.m_ping_pong.m_batch_durs));
+        }
+        if (opts.m_spin_usec != 0)
+        {
+          FLOW_LOG_INFO("    Event loop: " << result.m_ping_pong.m_spin);
+        }
+        FLOW_LOG_INFO("  Streaming: [" << std::llround(result.m_stream.m_msgs_per_sec) << "] msgs/sec; "
+                      "per-message (batch time / batch size) " << result.m_stream.m_lat);
+        if (g_counters.is_open())
+        {
+          FLOW_LOG_INFO("    Counters per message: " << result.m_stream.m_counters);
+        }
+        if (opts.m_report_repeats)
+        {
+          FLOW_LOG_INFO("    Each timed batch: " << repeats_str(result.m_stream.m_batch_durs));
+        }
+        if (opts.m_spin_usec != 0)
+        {
+          FLOW_LOG_INFO("    Event loop: " << result.m_stream.m_spin);
+        }
+
+        // Latency-bound traffic goes by median RTT; throughput-bound traffic by message rate.
+        if ((!best_ping_pong) || (result.m_ping_pong.m_lat.m_p50 < best_ping_pong->m_ping_pong.m_lat.m_p50))
+        {
+          best_ping_pong = &result;
+        }
+        if ((!best_stream) || (result.m_stream.m_msgs_per_sec > best_stream->m_stream.m_msgs_per_sec))
+        {
+          best_stream = &result;
+        }
+      }
+      FLOW_LOG_INFO("Fastest: request/response (by median RTT): "
+                    "[" << transport_name(best_ping_pong->m_transport) << "]; "
+                    "one-way streaming (by msgs/sec): [" << transport_name(best_stream->m_transport) << "].");
+    }
+
+    if (opts.m_bench_stl)
+    {
+      FLOW_LOG_INFO("SHM-native STL benchmark summary ([" << opts.m_n_warmup << "] warmup + "
+                    "[" << opts.m_n_repeats << "] timed iterations per container; "
+#if JEM_ELSE_CLASSIC
+                    "SHM-jemalloc"
+#else
+                    "SHM-classic"
+#endif
+                    "; map values are [" << S_STL_MAP_VAL_SZ << "]-char strings): ");
+      for (const auto& result : stl_results)
+      {
+        FLOW_LOG_INFO("[" << result.m_kind_name << "] of [" << result.m_n_elems << "] elements "
+                      "in [" << result.m_arena_name << "]: ");
+        FLOW_LOG_INFO("  Build (server):                " << result.m_build);
+        FLOW_LOG_INFO("  Lend (server):                 " << result.m_lend);
+        FLOW_LOG_INFO("  Transmit handle:               " << result.m_xmit);
+        FLOW_LOG_INFO("  Borrow (client):               " << result.m_borrow);
+        FLOW_LOG_INFO("  Traverse (client):             " << result.m_traverse);
+        FLOW_LOG_INFO("  Total (request to traversed):  " << result.m_total);
+        if (g_counters.is_open())
+        {
+          FLOW_LOG_INFO("  Counters per iteration (client side): " << result.m_counters);
+        }
+        if (opts.m_report_repeats)
+        {
+          FLOW_LOG_INFO("  Each timed iteration's total: " << repeats_str(result.m_total_samples));
+        }
+      }
+    }
+
+    if (opts.m_bench_async)
+    {
+      FLOW_LOG_INFO("Async-I/O-vs-sync_io benchmark summary (small-message ping-pong; "
+                    "[" << opts.m_small_n_msgs << "] round trips per batch; "
+                    "[" << opts.m_n_warmup << "] warmup + [" << opts.m_n_repeats << "] timed batches per path; "
+                    "context switches are process-wide, both voluntary and involuntary): ");
+      // Each kind of channel's sync_io run comes first; the async-I/O ones are compared against it.
+      const Async_result* baseline = nullptr;
+      for (const auto& result : async_results)
+      {
+        if ((!baseline) || (baseline->m_chan_name != result.m_chan_name))
+        {
+          baseline = &result;
+          FLOW_LOG_INFO("[" << result.m_chan_name << "] channel: ");
+        }
+        FLOW_LOG_INFO("  [" << result.m_api_name << "]: "
+                      "[" << std::llround(result.m_ping_pong.m_msgs_per_sec) << "] round trips/sec; "
+                      "RTT " << result.m_ping_pong.m_lat);
+        FLOW_LOG_INFO("    Context switches per round trip: [" << result.m_ping_pong.m_ctx_switches_per_msg << "].");
+        if (g_counters.is_open())
+        {
+          FLOW_LOG_INFO("    Counters per round trip: " << result.m_ping_pong.m_counters);
+        }
+        if (opts.m_report_repeats)
+        {
+          FLOW_LOG_INFO("    Each timed batch: " << repeats_str(result.m_ping_pong.m_batch_durs));
+        }
+        if (opts.m_spin_usec != 0)
+        {
+          FLOW_LOG_INFO("    Event loop: " << result.m_ping_pong.m_spin);
+        }
+        if (baseline != &result)
+        {
+          FLOW_LOG_INFO("    Added latency per round trip vs. sync_io (p50): "
+                        "[" << (to_usec(result.m_ping_pong.m_lat.m_p50) - to_usec(baseline->m_ping_pong.m_lat.m_p50))
+                        << "] usec.");
+        }
+      }
+    }
+
+    if (!opts.m_results_file.empty())
+    {
+      // Same results as summarized above (but not coarsened, and with all the stats); see results.hpp.
+      const auto config_base = result_config_base();
+      Result_rows rows;
+      {
+        // See "Run setup" above.  (No commas allowed in config.)
+        auto cpus = cpus_str(opts);
+        std::replace(cpus.begin(), cpus.end(), ',', '+');
+        rows.push_back({ "run_setup", config_base + ";client_cpus=" + cpus
+                                        + ";warmup=" + std::to_string(opts.m_n_warmup)
+                                        + ";repeats=" + std::to_string(opts.m_n_repeats)
+                                        + ";spin_usec=" + std::to_string(opts.m_spin_usec)
+                                        + ";open_shm_pool_mi=" + std::to_string(opts.m_open_shm_pool_mi),
+                         "prefault_mi", double(opts.m_prefault_mi) });
+      }
+      for (const auto& result : results)
+      {
+        const auto config_sz = ";size=" + std::to_string(result.m_data_sz);
+        add_result_rows(&rows, "capnp_raw", config_base + ";serialization=capnp_heap" + config_sz, result.m_raw);
+        add_result_rows(&rows, "capnp_zero_copy", config_base + ";serialization=session_shm" + config_sz,
+                        result.m_zcp);
+        if (g_counters.is_open())
+        {
+          add_counter_rows(&rows, "capnp_raw", config_base + ";serialization=capnp_heap" + config_sz,
+                           result.m_raw_counters, "iter");
+          add_counter_rows(&rows, "capnp_zero_copy", config_base + ";serialization=session_shm" + config_sz,
+                           result.m_zcp_counters, "iter");
+        }
+        if (opts.m_report_repeats)
+        {
+          add_repeat_rows(&rows, "capnp_raw", config_base + ";serialization=capnp_heap" + config_sz,
+                          result.m_raw_samples);
+          add_repeat_rows(&rows, "capnp_zero_copy", config_base + ";serialization=session_shm" + config_sz,
+                          result.m_zcp_samples);
+        }
+      }
+      for (const auto& result : small_results)
+      {
+        const auto config = config_base + ";serialization=" + result.m_config_name
+                              + ";batch=" + std::to_string(opts.m_small_n_msgs);
+        add_result_rows(&rows, "small_ping_pong", config, result.m_ping_pong.m_lat);
+        rows.push_back({ "small_ping_pong", config, "msgs_per_sec", result.m_ping_pong.m_msgs_per_sec });
+        add_result_rows(&rows, "small_stream", config, result.m_stream.m_lat);
+        rows.push_back({ "small_stream", config, "msgs_per_sec", result.m_stream.m_msgs_per_sec });
+        if (g_counters.is_open())
+        {
+          add_counter_rows(&rows, "small_ping_pong", config, result.m_ping_pong.m_counters, "msg");
+          add_counter_rows(&rows, "small_stream", config, result.m_stream.m_counters, "msg");
+        }
+        if (opts.m_report_repeats)
+        {
+          add_repeat_rows(&rows, "small_ping_pong", config, result.m_ping_pong.m_batch_durs);
+          add_repeat_rows(&rows, "small_stream", config, result.m_stream.m_batch_durs);
+        }
+      }
+      for (const auto& result : multi_results)
+      {
+        const auto config = config_base + ";serialization=session_shm;clients=" + std::to_string(result.m_n_clients)
+                              + ";batch=" + std::to_string(opts.m_small_n_msgs);
+        add_result_rows(&rows, "multi_client_ping_pong", config, result.m_lat);
+        rows.push_back({ "multi_client_ping_pong", config, "msgs_per_sec", result.m_msgs_per_sec });
+      }
+      for (const auto& result : transport_results)
+      {
+        const auto config = result_config_base(result.m_transport) + ";serialization=session_shm"
+                              + ";batch=" + std::to_string(opts.m_small_n_msgs);
+        add_result_rows(&rows, "transport_ping_pong", config, result.m_ping_pong.m_lat);
+        rows.push_back({ "transport_ping_pong", config, "msgs_per_sec", result.m_ping_pong.m_msgs_per_sec });
+        add_result_rows(&rows, "transport_stream", config, result.m_stream.m_lat);
+        rows.push_back({ "transport_stream", config, "msgs_per_sec", result.m_stream.m_msgs_per_sec });
+        if (g_counters.is_open())
+        {
+          add_counter_rows(&rows, "transport_ping_pong", config, result.m_ping_pong.m_counters, "msg");
+          add_counter_rows(&rows, "transport_stream", config, result.m_stream.m_counters, "msg");
+        }
+        if (opts.m_report_repeats)
+        {
+          add_repeat_rows(&rows, "transport_ping_pong", config, result.m_ping_pong.m_batch_durs);
+          add_repeat_rows(&rows, "transport_stream", config, result.m_stream.m_batch_durs);
+        }
+      }
+      for (const auto& result : stl_results)
+      {
+        const auto config = config_base + ";container=" + result.m_kind_name
+                              + ";elems=" + std::to_string(result.m_n_elems) + ";arena=" + result.m_arena_name;
+        add_result_rows(&rows, "stl_build", config, result.m_build);
+        add_result_rows(&rows, "stl_lend", config, result.m_lend);
+        add_result_rows(&rows, "stl_transmit", config, result.m_xmit);
+        add_result_rows(&rows, "stl_borrow", config, result.m_borrow);
+        add_result_rows(&rows, "stl_traverse", config, result.m_traverse);
+        add_result_rows(&rows, "stl_total", config, result.m_total);
+        if (g_counters.is_open())
+        {
+          add_counter_rows(&rows, "stl_total", config, result.m_counters, "iter");
+        }
+        if (opts.m_report_repeats)
+        {
+          add_repeat_rows(&rows, "stl_total", config, result.m_total_samples);
+        }
+      }
+      for (const auto& result : async_results)
+      {
+        const auto config = config_base + ';' + result.m_config_name + ";batch=" + std::to_string(opts.m_small_n_msgs);
+        add_result_rows(&rows, "api_ping_pong", config, result.m_ping_pong.m_lat);
+        rows.push_back({ "api_ping_pong", config, "msgs_per_sec", result.m_ping_pong.m_msgs_per_sec });
+        rows.push_back({ "api_ping_pong", config, "ctx_switches_per_msg", result.m_ping_pong.m_ctx_switches_per_msg });
+        if (g_counters.is_open())
+        {
+          add_counter_rows(&rows, "api_ping_pong", config, result.m_ping_pong.m_counters, "msg");
+        }
+        if (opts.m_report_repeats)
+        {
+          add_repeat_rows(&rows, "api_ping_pong", config, result.m_ping_pong.m_batch_durs);
+        }
+      }
+      if (open_result)
+      {
+        const auto& result = *open_result;
+        const auto add_cycles_rows = [&](const std::string& config, const Open_cycles_result& cycles)
+        {
+          add_result_rows(&rows, "session_open", config, cycles.m_session_open);
+          add_result_rows(&rows, "channel_open", config, cycles.m_channel_open);
+          add_result_rows(&rows, "session_close", config, cycles.m_session_close);
+        };
+        add_cycles_rows(config_base + ";init_chans=" + std::to_string(size_t(S_N_CHANS)), result.m_main);
+        for (const auto& transport_result : result.m_by_transport)
+        {
+          add_cycles_rows(result_config_base(transport_result.first)
+                            + ";init_chans=" + std::to_string(size_t(S_N_TRANSPORT_CHANS)),
+                          transport_result.second);
+        }
+        // Not session-open phases: timed on their own (see run_open()).
+        add_result_rows(&rows, "primitive_socket_connect", config_base, result.m_socket_connect);
+#if !JEM_ELSE_CLASSIC
+        add_result_rows(&rows, "primitive_shm_pool_create_map",
+                        config_base + ";pool_mi=" + std::to_string(opts.m_open_shm_pool_mi),
+                        result.m_shm_pool_create_map);
+#endif
+        add_result_rows(&rows, "primitive_posix_mq_create", config_base, result.m_posix_mq_create);
+        add_result_rows(&rows, "primitive_bipc_mq_create", config_base, result.m_bipc_mq_create);
+      }
+
+      std::ofstream results_os(opts.m_results_file);
+      write_results_csv(results_os, rows);
+      if (!results_os.flush())
+      {
+        throw Runtime_error("Could not write results file [" + opts.m_results_file + "].");
+      }
+      FLOW_LOG_INFO("Wrote [" << rows.size() << "] result values to [" << opts.m_results_file << "].");
+    }
+
+    if (opts.m_spin_usec != 0)
+    {
+      FLOW_LOG_INFO("Event loop spun up to [" << opts.m_spin_usec << " usec] per wait: " << g_spin_stats << '.');
+    }
+    FLOW_LOG_INFO("Exiting.");
+  } // try
+  catch (const exception& exc)
+  {
+    FLOW_LOG_WARNING("Caught exception: [" << exc.what() << "].");
+    FLOW_LOG_WARNING("(Perhaps you did not execute session-server executable in parallel, or "
+                     "you executed one or both of us oddly?)");
+    return 1;
+  }
+
+  return 0;
+} // main()
+
+std::vector<size_t> sweep_sizes(const Options& opts)
+{
+  using std::vector;
+
+  // Log-spaced between min and max inclusive.  Tiny ranges can yield duplicates after rounding; skip those.
+  vector<size_t> sizes;
+  const double ratio = double(opts.m_sweep_max_sz) / double(opts.m_sweep_min_sz);
+  for (unsigned int idx = 0; idx != opts.m_sweep_n_sizes; ++idx)
+  {
+    const double exp = (opts.m_sweep_n_sizes == 1) ? 0 : (double(idx) / double(opts.m_sweep_n_sizes - 1));
+    const auto sz = size_t(std::llround(double(opts.m_sweep_min_sz) * std::pow(ratio, exp)));
+    if (sizes.empty() || (sz != sizes.back()))
+    {
+      sizes.push_back(sz);
+    }
+  }
+  return sizes;
+}
+
+template<typename Channel_raw_t>
+void await_ctl(Channel_raw_t* chan_ptr, Ctl_msg* ctl)
+{
+  // Receive one Ctl_msg from server (e.g., an acknowledgment), running g_asio until it arrives if needed.
+  Error_code err_code;
+  size_t rcvd_sz;
+  chan_ptr->async_receive_blob(Blob_mutable(ctl, sizeof(*ctl)), &err_code, &rcvd_sz,
+                               [&](const Error_code& async_err_code, size_t)
+  {
+    err_code = async_err_code;
+    /* As in the benchmarks, .stop() is needed, since the structured channels always have an .async_wait()
+     * outstanding. */
+    g_asio.stop();
+  });
+  if (err_code == ipc::transport::error::Code::S_SYNC_IO_WOULD_BLOCK)
+  {
+    run_asio();
+    g_asio.restart();
+  }
+  if (err_code) { throw Runtime_error(err_code, "await_ctl()"); }
+}
+
+size_t prep_capnp(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr, size_t sz)
+{
+  using flow::Flow_log_component;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+
+  /* Ask server to prepare data of size `sz` (0 = whatever it has) and wait for its acknowledgment.  Not timed.
+   * This also serves as the initial sync handshake: once it's acked, the server is surely ready for get-cache
+   * requests on all channels. */
+  FLOW_LOG_INFO("> Asking server to prepare get-cache response data (size [" << sz << "] bytes; 0 = default).");
+  Ctl_msg ctl{ Ctl_msg::Cmd::S_PREP_CAPNP, sz };
+  chan_ptr->send_blob(Blob_const(&ctl, sizeof(ctl)));
+  await_ctl(chan_ptr, &ctl);
+  assert((ctl.m_cmd == Ctl_msg::Cmd::S_PREP_CAPNP) && "Server should have acked our prep request.");
+
+  FLOW_LOG_INFO("= Server ready; data size = [" << ctl.m_arg << "] bytes.");
+  g_total_sz = ctl.m_arg;
+  return g_total_sz;
+} // prep_capnp()
+
+void end_run(Channel_raw* chan_ptr)
+{
+  const Ctl_msg ctl{ Ctl_msg::Cmd::S_END, 0 };
+  chan_ptr->send_blob(Blob_const(&ctl, sizeof(ctl)));
+}
+
+template<typename Channel_struc_t, typename Channel_raw_t>
+Small_msgs_result run_small_msgs(flow::log::Logger* logger_ptr, Channel_struc_t* chan_ptr, Channel_raw_t* chan_raw_ptr,
+                                 const Options& opts, bool stream_else_ping_pong,
+                                 std::vector<flow::Fine_duration>* lat_samples)
+{
+  using flow::Flow_log_component;
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using flow::Fine_time_pt;
+  using flow::log::Logger;
+  using flow::log::Log_context;
+  using boost::asio::post;
+  using std::vector;
+
+  using Msg_in_ptr = typename Channel_struc_t::Msg_in_ptr;
+
+  /* Reminder: see main_srv.cpp Serve_algo::on_struc_request() counterpart.
+   *
+   * Each batch is opts.m_small_n_msgs small GetCacheReq messages; we do opts.m_n_warmup + opts.m_n_repeats batches,
+   * timing the latter.  Each message is built from scratch (create_msg() and all), as a real client would; so the
+   * per-message cost of that (including, for the SHM-backed channels, the SHM allocation) is part of what's
+   * measured.  We time via Fine_clock directly, not Checkpointing_timer as in the capnp benchmarks: at these
+   * scales (microseconds or less per message) the latter's overhead would show up in the results. */
+
+  auto& chan = *chan_ptr;
+  const unsigned int n_batches = opts.m_n_warmup + opts.m_n_repeats;
+  Small_msgs_result result;
+  const auto spin_stats_start = g_spin_stats;
+  Fine_duration timed_total = Fine_duration::zero();
+  uint64_t timed_ctx_switches = 0;
+  vector<Fine_duration> lats;
+
+  // Put server into the appropriate mode.  Not timed.
+  Ctl_msg ctl{ Ctl_msg::Cmd::S_SMALL_MSGS, stream_else_ping_pong ? opts.m_small_n_msgs : 0 };
+  chan_raw_ptr->send_blob(Blob_const(&ctl, sizeof(ctl)));
+  await_ctl(chan_raw_ptr, &ctl);
+  assert((ctl.m_cmd == Ctl_msg::Cmd::S_SMALL_MSGS) && "Server should have acked our small-message mode request.");
+
+  if (stream_else_ping_pong)
+  {
+    FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+    FLOW_LOG_INFO("-- RUN - small-message one-way streaming --");
+
+    /* One-way: fire off the batch's messages back to back; then wait for server to say it got them all.
+     * send() never blocks or would-blocks (what the transport won't take right now is queued inside the channel;
+     * and sent off as the transport becomes writable, as g_asio runs inside await_ctl()); so this measures
+     * sustained throughput, including the server-side receipt and deserialization of each message. */
+    lats.reserve(opts.m_n_repeats);
+    for (unsigned int batch_idx = 0; batch_idx != n_batches; ++batch_idx)
+    {
+      const bool timed = batch_idx >= opts.m_n_warmup;
+      if (timed)
+      {
+        g_counters.start();
+      }
+      const auto ctx_switches_start = process_ctx_switches();
+      const auto start = Fine_clock::now();
+      for (unsigned int msg_idx = 0; msg_idx != opts.m_small_n_msgs; ++msg_idx)
+      {
+        auto msg = chan.create_msg();
+        msg.body_root()->initGetCacheReq().setFileName("file.bin");
+        chan.send(msg);
+      }
+      await_ctl(chan_raw_ptr, &ctl);
+      assert((ctl.m_cmd == Ctl_msg::Cmd::S_SMALL_MSGS) && "Server should have reported end of batch.");
+      const auto batch_dur = Fine_clock::now() - start;
+
+      if (timed)
+      {
+        g_counters.stop();
+        timed_total += batch_dur;
+        result.m_batch_durs.push_back(batch_dur);
+        timed_ctx_switches += process_ctx_switches() - ctx_switches_start;
+        lats.push_back(batch_dur / Fine_duration::rep(opts.m_small_n_msgs));
+      }
+    }
+  }
+  else
+  {
+    struct Algo :
+      public Log_context
+    {
+      Channel_struc_t& m_chan;
+      const unsigned int m_n_msgs;
+      const unsigned int m_n_warmup;
+      const unsigned int m_n_batches;
+      unsigned int m_batch_idx = 0;
+      unsigned int m_msg_idx = 0;
+      Fine_time_pt m_batch_start;
+      Fine_time_pt m_msg_start;
+      Fine_duration m_timed_total = Fine_duration::zero();
+      uint64_t m_batch_ctx_switches_start = 0;
+      uint64_t m_timed_ctx_switches = 0;
+      vector<Fine_duration> m_rtts;
+      vector<Fine_duration> m_batch_durs;
+
+      Algo(Logger* logger_ptr, Channel_struc_t* chan_ptr, const Options& opts) :
+        Log_context(logger_ptr, Flow_log_component::S_UNCAT),
+        m_chan(*chan_ptr),
+        m_n_msgs(opts.m_small_n_msgs),
+        m_n_warmup(opts.m_n_warmup),
+        m_n_batches(opts.m_n_warmup + opts.m_n_repeats)
+      {
+        FLOW_LOG_INFO("-- RUN - small-message request/response ping-pong --");
+        m_rtts.reserve(size_t(opts.m_small_n_msgs) * opts.m_n_repeats);
+      }
+
+      void start_batch()
+      {
+        m_msg_idx = 0;
+        if (m_batch_idx >= m_n_warmup)
+        {
+          g_counters.start();
+        }
+        m_batch_ctx_switches_start = process_ctx_switches();
+        m_batch_start = Fine_clock::now();
+        send_request();
+      }
+
+      void send_request()
+      {
+        m_msg_start = Fine_clock::now();
+        auto req = m_chan.create_msg();
+        req.body_root()->initGetCacheReq().setFileName("file.bin");
+        m_chan.async_request(req, nullptr, nullptr,
+                             [this](Msg_in_ptr&& rsp) { on_response(std::move(rsp)); });
+      }
+
+      void on_response(Msg_in_ptr&& rsp)
+      {
+        const auto file_parts_list = rsp->body_root().getGetCacheRsp().getFileParts();
+        const auto now = Fine_clock::now();
+        const bool timed = m_batch_idx >= m_n_warmup;
+        if (timed)
+        {
+          m_rtts.push_back(now - m_msg_start);
+        }
+
+        if ((m_batch_idx == 0) && (m_msg_idx == 0))
+        {
+          if ((file_parts_list.size() != 1)
+              || (file_parts_list[0].getData().size() != file_parts_list[0].getDataSizeToVerify()))
+          {
+            throw Runtime_error("Small response does not look right... something is wrong.");
+          }
+        }
+        rsp.reset();
+
+        /* Not post()ing the next request, unlike in the capnp benchmarks: async_request() never invokes its handler
+         * synchronously, so there's no recursion to worry about; and a post() would add an extra trip through g_asio
+         * to each round trip -- which at these scales would be noticeable. */
+        if (++m_msg_idx != m_n_msgs)
+        {
+          send_request();
+          return;
+        }
+        // else: Batch done.
+        if (timed)
+        {
+          m_timed_total += now - m_batch_start;
+          m_batch_durs.push_back(now - m_batch_start);
+          m_timed_ctx_switches += process_ctx_switches() - m_batch_ctx_switches_start;
+          g_counters.stop();
+        }
+        if (++m_batch_idx == m_n_batches)
+        {
+          g_asio.stop();
+        }
+        else
+        {
+          start_batch();
+        }
+      } // on_response()
+    }; // class Algo
+
+    Algo algo(logger_ptr, chan_ptr, opts);
+    post(g_asio, [&]() { algo.start_batch(); });
+    run_asio();
+    g_asio.restart();
+    g_asio.poll();
+    g_asio.restart();
+
+    timed_total = algo.m_timed_total;
+    timed_ctx_switches = algo.m_timed_ctx_switches;
+    lats = std::move(algo.m_rtts);
+    result.m_batch_durs = std::move(algo.m_batch_durs);
+  }
+
+  result.m_timed_total = timed_total;
+  result.m_msgs_per_sec = double(opts.m_small_n_msgs) * double(opts.m_n_repeats)
+                            / (to_usec(timed_total) / 1000000.);
+  result.m_ctx_switches_per_msg = double(timed_ctx_switches) / (double(opts.m_small_n_msgs) * double(opts.m_n_repeats));
+  result.m_counters = g_counters.take().per(double(opts.m_small_n_msgs) * double(opts.m_n_repeats));
+  if (lat_samples)
+  {
+    *lat_samples = lats;
+  }
+  result.m_lat = Latency_stats(std::move(lats));
+  result.m_spin = { g_spin_stats.m_hits - spin_stats_start.m_hits, g_spin_stats.m_misses - spin_stats_start.m_misses };
+  return result;
+} // run_small_msgs()
+
+Multi_client_result run_multi_clients(flow::log::Logger* logger_ptr, const char* argv0, const Options& opts,
+                                      unsigned int n_clients)
+{
+  using flow::Flow_log_component;
+  using flow::Fine_duration;
+  using flow::util::ostream_op_string;
+  using std::string;
+  using std::vector;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+  FLOW_LOG_INFO("-- RUN - [" << n_clients << "] concurrent client processes; small-message ping-pong each --");
+
+  /* Spawn the clients: this same program, in its internal load-child mode (see run_load_child()).  fork() + execv()
+   * (the same way it was invoked: see ensure_run_env()) -- as opposed to just fork() -- as we have threads (e.g.,
+   * logging ones) by now.  For the same reason, everything the child needs is prepared before fork(). */
+  vector<string> out_paths;
+  vector<pid_t> pids;
+  for (unsigned int idx = 0; idx != n_clients; ++idx)
+  {
+    const auto name = ostream_op_string("perf_demo_cli.load-", n_clients, '-', idx);
+    out_paths.push_back(name + ".out");
+    vector<string> args{ argv0,
+                         "--load-child-out=" + out_paths.back(),
+                         ostream_op_string("--load-group=", n_clients),
+                         ostream_op_string("--small-count=", opts.m_small_n_msgs),
+                         ostream_op_string("--warmup=", opts.m_n_warmup),
+                         ostream_op_string("--repeats=", opts.m_n_repeats),
+                         ostream_op_string("--spin-usec=", opts.m_spin_usec),
+                         "--log-file=" + name + ".log" };
+    vector<char*> c_args;
+    for (auto& arg : args)
+    {
+      c_args.push_back(arg.data());
+    }
+    c_args.push_back(nullptr);
+
+    const auto pid = ::fork();
+    if (pid == 0)
+    {
+      ::execv(argv0, c_args.data());
+      ::_exit(127);
+    }
+    // else
+    if (pid == -1)
+    {
+      throw Runtime_error(Error_code(errno, boost::system::system_category()), "run_multi_clients():fork()");
+    }
+    pids.push_back(pid);
+  }
+
+  /* Reap them as they finish.  If one fails (it could not even execv(), or its session or a benchmark failed), the
+   * rest would likely never finish: they'd wait at the S_BARRIER for it forever.  So then kill those and give up. */
+  bool ok = true;
+  while (!pids.empty())
+  {
+    int status;
+    const auto pid = ::waitpid(-1, &status, 0);
+    if (pid == -1)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      // else
+      throw Runtime_error(Error_code(errno, boost::system::system_category()), "run_multi_clients():waitpid()");
+    }
+    // else
+    const auto pid_it = std::find(pids.begin(), pids.end(), pid);
+    if (pid_it == pids.end())
+    {
+      continue; // Not one of ours (we don't spawn others; but whatever).
+    }
+    // else
+    pids.erase(pid_it);
+    if (ok && (!(WIFEXITED(status) && (WEXITSTATUS(status) == 0))))
+    {
+      ok = false;
+      FLOW_LOG_WARNING("Client process [" << pid << "] failed (wait-status [" << status << "]); killing the other "
+                       "[" << pids.size() << "].");
+      for (const auto other_pid : pids)
+      {
+        ::kill(other_pid, SIGKILL);
+      }
+    }
+  }
+  if (!ok)
+  {
+    for (const auto& out_path : out_paths)
+    {
+      Error_code sink;
+      fs::remove(out_path, sink);
+    }
+    throw Runtime_error("A multi-client benchmark client process failed; see its console output and log file.");
+  }
+
+  /* Gather their results.  Aggregate throughput = all clients' round trips / the longest client's timed duration:
+   * they started their timed parts together (server released them from S_BARRIER at once), so that's the
+   * duration of the concurrent load, give or take the barrier release's own skew. */
+  Multi_client_result result{ n_clients, 0, {} };
+  vector<Fine_duration> lats;
+  auto max_timed_total = Fine_duration::zero();
+  for (const auto& out_path : out_paths)
+  {
+    std::ifstream is(out_path, std::ios::binary);
+    Fine_duration::rep timed_total;
+    uint64_t n_lats;
+    is.read(reinterpret_cast<char*>(&timed_total), sizeof(timed_total));
+    is.read(reinterpret_cast<char*>(&n_lats), sizeof(n_lats));
+    const auto prev_n_lats = lats.size();
+    lats.resize(prev_n_lats + n_lats);
+    is.read(reinterpret_cast<char*>(&lats[prev_n_lats]), n_lats * sizeof(Fine_duration));
+    if (!is)
+    {
+      throw Runtime_error("Could not read multi-client benchmark client results file [" + out_path + "].");
+    }
+    is.close();
+    fs::remove(out_path);
+
+    max_timed_total = std::max(max_timed_total, Fine_duration(timed_total));
+  }
+
+  result.m_msgs_per_sec = double(lats.size()) / (to_usec(max_timed_total) / 1000000.);
+  result.m_lat = Latency_stats(std::move(lats));
+  FLOW_LOG_INFO("= [" << n_clients << "] clients: aggregate [" << std::llround(result.m_msgs_per_sec) << "] "
+                "round trips/sec; RTT " << result.m_lat << '.');
+  return result;
+} // run_multi_clients()
+
+void run_load_child(flow::log::Logger* logger_ptr, Channel_struc* chan_ptr, Channel_raw* chan_raw_ptr,
+                    const Options& opts)
+{
+  using flow::Flow_log_component;
+  using flow::Fine_duration;
+  using std::vector;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+
+  // Warm up on our own: untimed.
+  if (opts.m_n_warmup != 0)
+  {
+    auto warmup_opts = opts;
+    warmup_opts.m_n_warmup = 0;
+    warmup_opts.m_n_repeats = opts.m_n_warmup;
+    run_small_msgs(logger_ptr, chan_ptr, chan_raw_ptr, warmup_opts, false);
+  }
+
+  // Then wait until the other clients are also ready, so that the timed parts of all of us run concurrently.
+  FLOW_LOG_INFO("> Ready; waiting for the other [" << (opts.m_load_group - 1) << "] clients.");
+  Ctl_msg ctl{ Ctl_msg::Cmd::S_BARRIER, opts.m_load_group };
+  chan_raw_ptr->send_blob(Blob_const(&ctl, sizeof(ctl)));
+  await_ctl(chan_raw_ptr, &ctl);
+  assert((ctl.m_cmd == Ctl_msg::Cmd::S_BARRIER) && "Server should have released us from barrier.");
+
+  auto timed_opts = opts;
+  timed_opts.m_n_warmup = 0;
+  vector<Fine_duration> lats;
+  const auto result = run_small_msgs(logger_ptr, chan_ptr, chan_raw_ptr, timed_opts, false, &lats);
+  FLOW_LOG_INFO("= Done: [" << std::llround(result.m_msgs_per_sec) << "] round trips/sec; RTT " << result.m_lat << '.');
+
+  // Report to the spawning process (run_multi_clients()): timed duration, sample count, samples.
+  std::ofstream os(opts.m_load_child_out, std::ios::binary);
+  const Fine_duration::rep timed_total = result.m_timed_total.count();
+  const uint64_t n_lats = lats.size();
+  os.write(reinterpret_cast<const char*>(&timed_total), sizeof(timed_total));
+  os.write(reinterpret_cast<const char*>(&n_lats), sizeof(n_lats));
+  os.write(reinterpret_cast<const char*>(lats.data()), n_lats * sizeof(Fine_duration));
+  if (!os.flush())
+  {
+    throw Runtime_error("Could not write results file [" + opts.m_load_child_out + "].");
+  }
+
+  ctl = { Ctl_msg::Cmd::S_END_SESSION, 0 };
+  chan_raw_ptr->send_blob(Blob_const(&ctl, sizeof(ctl)));
+} // run_load_child()
+
+Open_result run_open(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts)
+{
+  using flow::Flow_log_component;
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using ipc::transport::Native_socket_stream_acceptor;
+  using ipc::transport::Posix_mq_handle;
+  using ipc::transport::Bipc_mq_handle;
+  using ipc::session::build_conventional_shared_name;
+  using ipc::util::Shared_name;
+  using boost::promise;
+  using std::vector;
+  using std::to_string;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+
+  FLOW_LOG_INFO("-- RUN - session open, channel open, session close --");
+  Open_result result;
+  result.m_main = time_open_cycles<Transport::S_SOCKET>(logger_ptr, ipc_logger_ptr, opts, S_N_CHANS);
+  /* The same, for sessions differing only in whether their channels have MQs (and which kind) besides the socket.
+   * (Those Session_servers give out S_N_TRANSPORT_CHANS init-channels: see Accept_algo.) */
+  result.m_by_transport.emplace_back(Transport::S_SOCKET_HNDL,
+                                     time_open_cycles<Transport::S_SOCKET_HNDL>(logger_ptr, ipc_logger_ptr, opts,
+                                                                               S_N_TRANSPORT_CHANS));
+  result.m_by_transport.emplace_back(Transport::S_POSIX_MQ_HNDL,
+                                     time_open_cycles<Transport::S_POSIX_MQ_HNDL>(logger_ptr, ipc_logger_ptr, opts,
+                                                                                 S_N_TRANSPORT_CHANS));
+  result.m_by_transport.emplace_back(Transport::S_BIPC_MQ_HNDL,
+                                     time_open_cycles<Transport::S_BIPC_MQ_HNDL>(logger_ptr, ipc_logger_ptr, opts,
+                                                                                S_N_TRANSPORT_CHANS));
+
+  /* Now some of the primitives a session open is built from, in isolation, for reference.  (Flow-IPC does not expose
+   * timings of a session-open's innards.)  Their names are made in the same way the sessions make theirs, though in
+   * our own (per-process) corner. */
+  FLOW_LOG_INFO("-- RUN - isolated primitives: socket connect; SHM pool create+map; MQ create --");
+  const unsigned int n_iterations = opts.m_n_warmup + opts.m_n_repeats;
+  const auto name_func = [](const Shared_name& resource_type) -> Shared_name
+  {
+    auto name = build_conventional_shared_name(resource_type, Shared_name::ct(CLI_NAME),
+                                               Shared_name::ct(to_string(::getpid())));
+    name /= "perfDemoOpen";
+    return name;
+  };
+
+  {
+    // Connecting a local-stream-socket; like the one underlying a session's master channel.
+    const auto acceptor_name = name_func(Native_socket_stream_acceptor::S_RESOURCE_TYPE_ID);
+    Native_socket_stream_acceptor acceptor(ipc_logger_ptr, acceptor_name); // Let it throw on error.
+
+    vector<Fine_duration> connects;
+    for (unsigned int idx = 0; idx != n_iterations; ++idx)
+    {
+      Native_socket_stream_acceptor::Peer peer;
+      promise<Error_code> accepted;
+      acceptor.async_accept(&peer, [&](const Error_code& err_code) { accepted.set_value(err_code); });
+      ipc::transport::sync_io::Native_socket_stream sock(ipc_logger_ptr, "perfDemoOpen");
+
+      const auto start = Fine_clock::now();
+      sock.sync_connect(acceptor_name); // Let it throw on error.
+      const auto connect = Fine_clock::now() - start;
+
+      // Not timed: the accept happens concurrently anyway (in the acceptor's thread); but don't leave it dangling.
+      const auto err_code = accepted.get_future().get();
+      if (err_code) { throw Runtime_error(err_code, "run_open():async_accept()"); }
+      if (idx >= opts.m_n_warmup)
+      {
+        connects.push_back(connect);
+      }
+    }
+    result.m_socket_connect = Latency_stats(std::move(connects));
+  }
+
+  /* Pages are not touched, so this is mostly about the system calls and the mapping itself.  (SHM-jemalloc does no
+   * such thing at session open -- it creates its pools on demand, of sizes of its choosing -- so with it, skip it.) */
+#if !JEM_ELSE_CLASSIC
+  result.m_shm_pool_create_map
+    = Latency_stats(time_shm_pool_create_map('/' + name_func(Shared_name::S_RESOURCE_TYPE_ID_SHM).str(), opts));
+#endif
+  result.m_posix_mq_create
+    = Latency_stats(time_mq_create<Posix_mq_handle>(ipc_logger_ptr, name_func(Posix_mq_handle::S_RESOURCE_TYPE_ID),
+                                                    opts));
+  result.m_bipc_mq_create
+    = Latency_stats(time_mq_create<Bipc_mq_handle>(ipc_logger_ptr, name_func(Bipc_mq_handle::S_RESOURCE_TYPE_ID),
+                                                   opts));
+  FLOW_LOG_INFO("= Socket connect " << result.m_socket_connect << "; "
+#if !JEM_ELSE_CLASSIC
+                "SHM pool create+map " << result.m_shm_pool_create_map << "; "
+#endif
+                "POSIX MQ create " << result.m_posix_mq_create << "; "
+                "bipc MQ create " << result.m_bipc_mq_create << '.');
+  return result;
+} // run_open()
+
+template<Transport S_TRANSPORT>
+Open_cycles_result time_open_cycles(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr,
+                                    const Options& opts, [[maybe_unused]] size_t n_init_chans)
+{
+  using flow::Flow_log_component;
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using std::optional;
+  using std::vector;
+
+  using Session = typename Transport_types<S_TRANSPORT>::Client_session;
+  using Channel_raw_t = typename Transport_types<S_TRANSPORT>::Channel_raw;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+
+  /* Reminder: see main_srv.cpp Accept_algo::on_accepted(); each session we open here is accepted like any other of
+   * its transport (including ours in main(), for S_SOCKET), with the same init-channels; and it accepts our
+   * open_channel()s.
+   *
+   * Each of opts.m_n_warmup + opts.m_n_repeats cycles: open a session (timed); sync up with the server (untimed:
+   * see below); open a channel (timed); tell server we're done with the session (untimed); close it all (timed).
+   * We use the session's blocking APIs, and time via Fine_clock directly, as these are what an application would
+   * use (and see) in practice; the server-side work (accepting, creating its SHM arena, its MQs if any, and so on)
+   * happens in the meantime, so it is included. */
+  vector<Fine_duration> session_opens;
+  vector<Fine_duration> channel_opens;
+  vector<Fine_duration> session_closes;
+  for (unsigned int idx = 0; idx != (opts.m_n_warmup + opts.m_n_repeats); ++idx)
+  {
+    optional<Session> session;
+    typename Session::Channels chans;
+    optional<Channel_raw_t> chan;
+
+    auto start = Fine_clock::now();
+    session.emplace(ipc_logger_ptr, CLI_APPS.find(CLI_NAME)->second,
+                    SRV_APPS.find(transport_srv_name(S_TRANSPORT))->second, [](const Error_code&) {});
+    session->sync_connect(session->mdt_builder(), nullptr, nullptr, &chans); // Let it throw on error.
+    const auto session_open = Fine_clock::now() - start;
+    assert(chans.size() >= n_init_chans);
+
+    /* The server might not yet have gotten around to readying its side of the session (it does so in its own event
+     * loop, after its accept completes); before then our open_channel() would be timing the server's backlog, not
+     * the channel opening.  So wait for that: a 1-client S_BARRIER is a round trip answered by the session's
+     * Serve_algo, which is up only once the session's handlers are set. */
+    auto& chan_raw = chans[S_CHAN_RAW];
+    chan_raw.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+    chan_raw.start_send_blob_ops(ev_wait);
+    chan_raw.start_receive_blob_ops(ev_wait);
+    Ctl_msg ctl{ Ctl_msg::Cmd::S_BARRIER, 1 };
+    chan_raw.send_blob(Blob_const(&ctl, sizeof(ctl)));
+    await_ctl(&chan_raw, &ctl);
+    assert((ctl.m_cmd == Ctl_msg::Cmd::S_BARRIER) && "Server should have acked our 1-client barrier.");
+
+    start = Fine_clock::now();
+    chan.emplace();
+    session->open_channel(&(*chan)); // Let it throw on error.
+    const auto channel_open = Fine_clock::now() - start;
+
+    ctl = { Ctl_msg::Cmd::S_END_SESSION, 0 };
+    chan_raw.send_blob(Blob_const(&ctl, sizeof(ctl)));
+
+    start = Fine_clock::now();
+    chan.reset();
+    chans.clear();
+    session.reset();
+    const auto session_close = Fine_clock::now() - start;
+    // Flush any now-canceled async_wait()s of chan_raw's out of g_asio.
+    g_asio.poll();
+    g_asio.restart();
+
+    if (idx >= opts.m_n_warmup)
+    {
+      session_opens.push_back(session_open);
+      channel_opens.push_back(channel_open);
+      session_closes.push_back(session_close);
+    }
+  }
+
+  Open_cycles_result result{ Latency_stats(std::move(session_opens)), Latency_stats(std::move(channel_opens)),
+                             Latency_stats(std::move(session_closes)) };
+  FLOW_LOG_INFO("= [" << transport_name(S_TRANSPORT) << "]: session open " << result.m_session_open << "; "
+                "channel open " << result.m_channel_open << "; session close " << result.m_session_close << '.');
+  return result;
+} // time_open_cycles()
+
+template<typename Mq>
+std::vector<flow::Fine_duration> time_mq_create(flow::log::Logger* ipc_logger_ptr,
+                                               const ipc::util::Shared_name& name, const Options& opts)
+{
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using std::optional;
+  using std::vector;
+
+  /* Create an MQ as a session does for each direction of an MQ-backed channel: 10 messages deep; each up to the
+   * non-SHM-backed channels' max message size (for SHM-backed ones it's far smaller; that's not much different
+   * cost-wise).  Then close and remove it (not timed). */
+  constexpr size_t MAX_N_MSG = 10;
+  constexpr size_t MAX_MSG_SZ = 8 * 1024;
+
+  vector<Fine_duration> creates;
+  for (unsigned int idx = 0; idx != (opts.m_n_warmup + opts.m_n_repeats); ++idx)
+  {
+    optional<Mq> mq;
+    const auto start = Fine_clock::now();
+    mq.emplace(ipc_logger_ptr, name, ipc::util::CREATE_ONLY, MAX_N_MSG, MAX_MSG_SZ); // Let it throw on error.
+    const auto create = Fine_clock::now() - start;
+
+    mq.reset();
+    Mq::remove_persistent(ipc_logger_ptr, name);
+    if (idx >= opts.m_n_warmup)
+    {
+      creates.push_back(create);
+    }
+  }
+  return creates;
+} // time_mq_create()
+
+std::vector<flow::Fine_duration> time_shm_pool_create_map(const std::string& name, const Options& opts)
+{
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using boost::system::system_category;
+  using std::vector;
+
+  /* Create and map an SHM pool, as a session's SHM-provider does (directly: the same system calls, sans the
+   * provider's bookkeeping).  Then unmap and remove it (not timed). */
+  const auto fail = [&](const char* what, int fd)
+  {
+    const Error_code err_code(errno, system_category());
+    if (fd != -1)
+    {
+      ::close(fd);
+    }
+    ::shm_unlink(name.c_str());
+    throw Runtime_error(err_code, std::string("time_shm_pool_create_map():") + what);
+  };
+
+  const size_t pool_sz = opts.m_open_shm_pool_mi * 1024 * 1024;
+  vector<Fine_duration> creates;
+  for (unsigned int idx = 0; idx != (opts.m_n_warmup + opts.m_n_repeats); ++idx)
+  {
+    const auto start = Fine_clock::now();
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) { fail("shm_open()", fd); }
+    if (::ftruncate(fd, pool_sz) == -1) { fail("ftruncate()", fd); }
+    void* const addr = ::mmap(nullptr, pool_sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int mmap_errno = errno; // close() may clobber it.
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+      errno = mmap_errno;
+      fail("mmap()", -1);
+    }
+    const auto create = Fine_clock::now() - start;
+
+    ::munmap(addr, pool_sz);
+    ::shm_unlink(name.c_str());
+    if (idx >= opts.m_n_warmup)
+    {
+      creates.push_back(create);
+    }
+  }
+  return creates;
+} // time_shm_pool_create_map()
+
+Transport_result run_transport(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts,
+                               Transport transport)
+{
+  // Session types differ by transport, so it's a compile-time thing from here on.
+  switch (transport)
+  {
+  case Transport::S_SOCKET:
+    return run_transport<Transport::S_SOCKET>(logger_ptr, ipc_logger_ptr, opts);
+  case Transport::S_SOCKET_HNDL:
+    return run_transport<Transport::S_SOCKET_HNDL>(logger_ptr, ipc_logger_ptr, opts);
+  case Transport::S_POSIX_MQ:
+    return run_transport<Transport::S_POSIX_MQ>(logger_ptr, ipc_logger_ptr, opts);
+  case Transport::S_POSIX_MQ_HNDL:
+    return run_transport<Transport::S_POSIX_MQ_HNDL>(logger_ptr, ipc_logger_ptr, opts);
+  case Transport::S_BIPC_MQ:
+    return run_transport<Transport::S_BIPC_MQ>(logger_ptr, ipc_logger_ptr, opts);
+  case Transport::S_BIPC_MQ_HNDL:
+    return run_transport<Transport::S_BIPC_MQ_HNDL>(logger_ptr, ipc_logger_ptr, opts);
+  case Transport::S_END_SENTINEL:
+    break;
+  }
+  assert(false && "Bad Transport.");
+  return {};
+}
+
+template<Transport S_TRANSPORT>
+Transport_result run_transport(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts)
+{
+  using flow::Flow_log_component;
+
+  using Session = typename Transport_types<S_TRANSPORT>::Client_session;
+  using Channel_struc_t = typename Transport_types<S_TRANSPORT>::Channel_struc;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+  FLOW_LOG_INFO("-- RUN - small messages over transport [" << transport_name(S_TRANSPORT) << "] --");
+
+  /* Reminder: see main_srv.cpp Accept_algo.  The server accepts sessions of each transport via a different server app;
+   * so that's what we pick here.  Otherwise it's like main() but leaner: a separate session with just the channels
+   * we need (see Chan_idx); then the same small-message benchmarks as run_both() in main() runs. */
+  Session session(ipc_logger_ptr,
+                  CLI_APPS.find(CLI_NAME)->second,
+                  SRV_APPS.find(transport_srv_name(S_TRANSPORT))->second, [](const Error_code&) {});
+  typename Session::Channels chans;
+  session.sync_connect(session.mdt_builder(), nullptr, nullptr, &chans); // Let it throw on error.
+  assert(chans.size() >= S_N_TRANSPORT_CHANS);
+
+  auto& chan_raw = chans[S_CHAN_RAW];
+  Channel_struc_t chan_struc(ipc_logger_ptr, std::move(chans[S_CHAN_STRUC_SESSION_SHM]),
+                             ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM, &session);
+  chan_raw.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+  chan_raw.start_send_blob_ops(ev_wait);
+  chan_raw.start_receive_blob_ops(ev_wait);
+  chan_struc.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+  chan_struc.start_ops(ev_wait);
+  chan_struc.start_and_poll([](const Error_code&) {});
+
+  Transport_result result{ S_TRANSPORT,
+                           run_small_msgs(logger_ptr, &chan_struc, &chan_raw, opts, false),
+                           run_small_msgs(logger_ptr, &chan_struc, &chan_raw, opts, true) };
+  FLOW_LOG_INFO("= [" << transport_name(S_TRANSPORT) << "]: "
+                "ping-pong [" << std::llround(result.m_ping_pong.m_msgs_per_sec) << "] round trips/sec; "
+                "streaming [" << std::llround(result.m_stream.m_msgs_per_sec) << "] msgs/sec.");
+
+  const Ctl_msg ctl{ Ctl_msg::Cmd::S_END_SESSION, 0 };
+  chan_raw.send_blob(Blob_const(&ctl, sizeof(ctl)));
+  return result;
+  /* Channels, then session, are destroyed now.  That cancels any async_wait()s outstanding on g_asio; the next
+   * g_asio.run() or .poll() flushes them harmlessly. */
+} // run_transport()
+
+std::vector<Async_result> run_async(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr,
+                                    Client_session* session_ptr, Client_session::Channels* chans_ptr,
+                                    Channel_struc* chan_struc_ptr, Channel_raw* chan_raw_ptr, const Options& opts)
+{
+  using std::vector;
+
+  /* The same ping-pong, via the sync_io API (as everything else in this program) and via the async-I/O API; the
+   * latter in 2 variants: see run_small_msgs_async_io().  First over structured channels (where the sync_io run is
+   * simply the session-SHM small-message ping-pong benchmark); then raw Native_socket_streams (see S_CHAN_ECHO).
+   * The structured channels are different ones (see S_CHAN_STRUC_ASYNC) but identically configured; likewise the
+   * raw ones.  Not that it would matter: the point is the API, and the server does not even know which one we use. */
+  auto& chans = *chans_ptr;
+  vector<Async_result> results;
+
+  results.push_back({ "structured", "sync_io", "channel=struc_session_shm;api=sync_io",
+                      run_small_msgs(logger_ptr, chan_struc_ptr, chan_raw_ptr, opts, false) });
+
+  Channel_struc_async chan_struc_async(ipc_logger_ptr, std::move(chans[S_CHAN_STRUC_ASYNC]),
+                                       ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM, session_ptr);
+  chan_struc_async.start([](const Error_code&) {});
+  results.push_back({ "structured", "async-I/O, handled in its thread", "channel=struc_session_shm;api=async_io",
+                      run_small_msgs_async_io(logger_ptr, &chan_struc_async, chan_raw_ptr, opts, false) });
+  results.push_back({ "structured", "async-I/O, post()ed to ours", "channel=struc_session_shm;api=async_io_post",
+                      run_small_msgs_async_io(logger_ptr, &chan_struc_async, chan_raw_ptr, opts, true) });
+
+  // The channels are Unix-domain-socket-based; so each holds a Native_socket_stream; take it over.
+  Sock_sync_io sock(std::move(*chans[S_CHAN_ECHO].blob_snd()));
+  sock.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+  sock.start_send_blob_ops(ev_wait);
+  sock.start_receive_blob_ops(ev_wait);
+  results.push_back({ "raw", "sync_io", "channel=raw_socket;api=sync_io", run_echo(logger_ptr, &sock, opts, false) });
+
+  Sock_async sock_async(std::move(*chans[S_CHAN_ECHO_ASYNC].blob_snd()));
+  results.push_back({ "raw", "async-I/O, handled in its thread", "channel=raw_socket;api=async_io",
+                      run_echo(logger_ptr, &sock_async, opts, false) });
+  results.push_back({ "raw", "async-I/O, post()ed to ours", "channel=raw_socket;api=async_io_post",
+                      run_echo(logger_ptr, &sock_async, opts, true) });
+  return results;
+} // run_async()
+
+Small_msgs_result run_small_msgs_async_io(flow::log::Logger* logger_ptr, Channel_struc_async* chan_ptr,
+                                          Channel_raw* chan_raw_ptr, const Options& opts, bool hop)
+{
+  using flow::Flow_log_component;
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using flow::Fine_time_pt;
+  using flow::log::Logger;
+  using flow::log::Log_context;
+  using boost::asio::post;
+  using std::vector;
+
+  using Msg_in_ptr = Channel_struc_async::Msg_in_ptr;
+
+  /* Reminder: this is run_small_msgs() ping-pong, but via the async-I/O struc::Channel.  Its handlers run in
+   * a channel-internal thread (thread W), not ours.  If `hop`, our response handler post()s the response onto our
+   * thread (g_asio), where we deal with it and send the next request: as a typical application would, wanting to
+   * keep its own logic in its own thread(s).  Otherwise we deal with it right there in thread W: that's the least
+   * overhead the async-I/O API can have; but few applications would want their logic running in some library's
+   * thread. */
+
+  Ctl_msg ctl{ Ctl_msg::Cmd::S_SMALL_MSGS, 0 };
+  chan_raw_ptr->send_blob(Blob_const(&ctl, sizeof(ctl)));
+  await_ctl(chan_raw_ptr, &ctl);
+  assert((ctl.m_cmd == Ctl_msg::Cmd::S_SMALL_MSGS) && "Server should have acked our small-message mode request.");
+
+  struct Algo :
+    public Log_context
+  {
+    Channel_struc_async& m_chan;
+    const bool m_hop;
+    const unsigned int m_n_msgs;
+    const unsigned int m_n_warmup;
+    const unsigned int m_n_batches;
+    unsigned int m_batch_idx = 0;
+    unsigned int m_msg_idx = 0;
+    Fine_time_pt m_batch_start;
+    Fine_time_pt m_msg_start;
+    Fine_duration m_timed_total = Fine_duration::zero();
+    uint64_t m_batch_ctx_switches_start = 0;
+    uint64_t m_timed_ctx_switches = 0;
+    vector<Fine_duration> m_rtts;
+    vector<Fine_duration> m_batch_durs;
+
+    Algo(Logger* logger_ptr, Channel_struc_async* chan_ptr, const Options& opts, bool hop) :
+      Log_context(logger_ptr, Flow_log_component::S_UNCAT),
+      m_chan(*chan_ptr),
+      m_hop(hop),
+      m_n_msgs(opts.m_small_n_msgs),
+      m_n_warmup(opts.m_n_warmup),
+      m_n_batches(opts.m_n_warmup + opts.m_n_repeats)
+    {
+      FLOW_LOG_INFO("-- RUN - small-message request/response ping-pong via async-I/O API "
+                    "(" << (m_hop ? "post()ed to our thread" : "handled in its thread") << ") --");
+      m_rtts.reserve(size_t(opts.m_small_n_msgs) * opts.m_n_repeats);
+    }
 
-#include "common.hpp"
-#include <flow/perf/checkpt_timer.hpp>
+    void start_batch()
+    {
+      m_msg_idx = 0;
+      if (m_batch_idx >= m_n_warmup)
+      {
+        g_counters.start();
+      }
+      m_batch_ctx_switches_start = process_ctx_switches();
+      m_batch_start = Fine_clock::now();
+      send_request();
+    }
 
-void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan);
-void run_capnp_zero_cpy(flow::log::Logger* logger_ptr, Channel_struc* chan);
-void verify_rsp(const perf_demo::schema::GetCacheRsp::Reader& rsp_root);
+    void send_request()
+    {
+      m_msg_start = Fine_clock::now();
+      auto req = m_chan.create_msg();
+      req.body_root()->initGetCacheReq().setFileName("file.bin");
+      m_chan.async_request(req, nullptr, nullptr, [this](Msg_in_ptr&& rsp)
+      {
+        // We're in thread W.
+        if (m_hop)
+        {
+          post(g_asio, [this, rsp = std::move(rsp)]() mutable { on_response(std::move(rsp)); });
+        }
+        else
+        {
+          on_response(std::move(rsp));
+        }
+      });
+    }
 
-using Timer = flow::perf::Checkpointing_timer;
-using Clock_type = flow::perf::Clock_type;
+    void on_response(Msg_in_ptr&& rsp)
+    {
+      const auto file_parts_list = rsp->body_root().getGetCacheRsp().getFileParts();
+      const auto now = Fine_clock::now();
+      const bool timed = m_batch_idx >= m_n_warmup;
+      if (timed)
+      {
+        m_rtts.push_back(now - m_msg_start);
+      }
+      if ((m_batch_idx == 0) && (m_msg_idx == 0) && (file_parts_list.size() != 1))
+      {
+        throw Runtime_error("Small response does not look right... something is wrong.");
+      }
+      rsp.reset();
 
-static Task_engine g_asio;
-/* These globals (which, again, don't really need to be global but are just for expediency for now at least, as they're
- * referenced in a few benchmarks) are set by diff benchmarks and then summarized/analyzed a bit at the end of
- * main(). */
-static flow::Fine_duration g_capnp_over_raw_rtt;
-static flow::Fine_duration g_capnp_zero_cpy_rtt;
-// Byte count inside the transmitted data.  1st benchmark sets it; 2nd benchmarks ensures it got same-sized data too.
-static size_t g_total_sz = 0;
+      // As in run_small_msgs(): async_request() never invokes its handler synchronously; so no recursion.
+      if (++m_msg_idx != m_n_msgs)
+      {
+        send_request();
+        return;
+      }
+      // else: Batch done.
+      if (timed)
+      {
+        m_timed_total += now - m_batch_start;
+        m_batch_durs.push_back(now - m_batch_start);
+        m_timed_ctx_switches += process_ctx_switches() - m_batch_ctx_switches_start;
+        g_counters.stop();
+      }
+      if (++m_batch_idx == m_n_batches)
+      {
+        g_asio.stop(); // This is thread-safe, even if we're in thread W.
+      }
+      else
+      {
+        start_batch();
+      }
+    } // on_response()
+  }; // class Algo
 
-int main(int argc, char const * const * argv)
+  Algo algo(logger_ptr, chan_ptr, opts, hop);
+  /* Unlike in the other benchmarks, g_asio might run out of work while waiting for thread W to do stuff (it
+   * wouldn't, as the sync_io-pattern channels always have an .async_wait() outstanding; but let's not rely on it). */
+  const auto work_guard = boost::asio::make_work_guard(g_asio);
+  post(g_asio, [&]() { algo.start_batch(); });
+  g_asio.run();
+  g_asio.restart();
+  g_asio.poll();
+  g_asio.restart();
+
+  Small_msgs_result result;
+  result.m_timed_total = algo.m_timed_total;
+  result.m_msgs_per_sec = double(opts.m_small_n_msgs) * double(opts.m_n_repeats)
+                            / (to_usec(algo.m_timed_total) / 1000000.);
+  result.m_ctx_switches_per_msg = double(algo.m_timed_ctx_switches)
+                                    / (double(opts.m_small_n_msgs) * double(opts.m_n_repeats));
+  result.m_counters = g_counters.take().per(double(opts.m_small_n_msgs) * double(opts.m_n_repeats));
+  result.m_batch_durs = std::move(algo.m_batch_durs);
+  result.m_lat = Latency_stats(std::move(algo.m_rtts));
+  return result;
+} // run_small_msgs_async_io()
+
+template<typename Sock>
+Small_msgs_result run_echo(flow::log::Logger* logger_ptr, Sock* sock_ptr, const Options& opts, bool hop)
 {
-  using Session = Client_session;
-  using flow::log::Simple_ostream_logger;
-  using flow::log::Async_file_logger;
   using flow::Flow_log_component;
-  using flow::util::ceil_div;
-  using boost::promise;
-  using boost::chrono::microseconds;
-  using boost::chrono::round;
-  using std::exception;
-  using std::optional;
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using flow::Fine_time_pt;
+  using flow::log::Logger;
+  using flow::log::Log_context;
+  using boost::asio::post;
+  using std::vector;
 
-  /* Set up logging within this function.  We could easily just use `cout` and `cerr` instead, but this
-   * Flow stuff will give us time stamps and such for free, so why not?  Normally, one derives from
-   * Log_context to do this very trivially, but we just have the one function, main(), so far so: */
-  optional<Simple_ostream_logger> std_logger;
-  optional<Async_file_logger> log_logger;
-  setup_logging(&std_logger, &log_logger, argc, argv, false);
-  FLOW_LOG_SET_CONTEXT(&(*std_logger), Flow_log_component::S_UNCAT);
+  constexpr bool S_SYNC_IO = std::is_same_v<Sock, Sock_sync_io>;
 
-#if JEM_ELSE_CLASSIC
-  ipc::session::shm::arena_lend::Borrower_shm_pool_collection_repository_singleton::get_instance()
-    .set_logger(&(*log_logger));
-#endif
+  /* Reminder: see main_srv.cpp Echo_algo.  Ping-pong of S_ECHO_MSG_SZ-sized blobs: we send one; server echoes it;
+   * we receive it; repeat.  With Sock_sync_io it's the sync_io pattern, as in run_capnp_over_raw() for example; so
+   * `hop` is meaningless.  With Sock_async it's the async-I/O API; `hop` is as in run_small_msgs_async_io(). */
 
-  try
+  struct Algo :
+    public Log_context
   {
-    ensure_run_env(argv[0], false);
+    Sock& m_sock;
+    const bool m_hop;
+    const unsigned int m_n_msgs;
+    const unsigned int m_n_warmup;
+    const unsigned int m_n_batches;
+    unsigned int m_batch_idx = 0;
+    unsigned int m_msg_idx = 0;
+    std::array<uint8_t, S_ECHO_MSG_SZ> m_buf;
+    Error_code m_err_code;
+    size_t m_sz;
+    Fine_time_pt m_batch_start;
+    Fine_time_pt m_msg_start;
+    Fine_duration m_timed_total = Fine_duration::zero();
+    uint64_t m_batch_ctx_switches_start = 0;
+    uint64_t m_timed_ctx_switches = 0;
+    vector<Fine_duration> m_rtts;
+    vector<Fine_duration> m_batch_durs;
+
+    Algo(Logger* logger_ptr, Sock* sock_ptr, const Options& opts, bool hop) :
+      Log_context(logger_ptr, Flow_log_component::S_UNCAT),
+      m_sock(*sock_ptr),
+      m_hop(hop),
+      m_n_msgs(opts.m_small_n_msgs),
+      m_n_warmup(opts.m_n_warmup),
+      m_n_batches(opts.m_n_warmup + opts.m_n_repeats)
+    {
+      FLOW_LOG_INFO("-- RUN - raw request/response ping-pong via " << (S_SYNC_IO ? "sync_io" : "async-I/O") << " "
+                    "Native_socket_stream" << (S_SYNC_IO ? "" : (m_hop ? " (post()ed to our thread)"
+                                                                        : " (handled in its thread)")) << " --");
+      m_buf.fill(uint8_t(0xAB)); // Dummy data... let's not just leave it as zeroes.
+      m_rtts.reserve(size_t(opts.m_small_n_msgs) * opts.m_n_repeats);
+    }
 
-    Session session(&(*log_logger),
-                    CLI_APPS.find(CLI_NAME)->second,
-                    SRV_APPS.find(SRV_NAME)->second, [](const Error_code&) {});
+    void start_batch()
+    {
+      m_msg_idx = 0;
+      if (m_batch_idx >= m_n_warmup)
+      {
+        g_counters.start();
+      }
+      m_batch_ctx_switches_start = process_ctx_switches();
+      m_batch_start = Fine_clock::now();
+      send_request();
+    }
 
-    FLOW_LOG_INFO("Session-client attempting to open session against session-server; "
-                  "it'll either succeed or fail very soon.");
+    void send_request()
+    {
+      /* sync_io: a receive can complete synchronously; so careful to iterate, not recurse (see run_capnp_over_raw()).
+       * async-I/O: it never does; its handler is always invoked later, from thread W. */
+      do
+      {
+        m_msg_start = Fine_clock::now();
+        m_sock.send_blob(Blob_const(m_buf.data(), m_buf.size()));
+        if constexpr(S_SYNC_IO)
+        {
+          m_sock.async_receive_blob(Blob_mutable(m_buf.data(), m_buf.size()), &m_err_code, &m_sz,
+                                    [this](const Error_code& err_code, size_t sz)
+          {
+            if (on_response(err_code, sz))
+            {
+              send_request();
+            }
+          });
+          if (m_err_code == ipc::transport::error::Code::S_SYNC_IO_WOULD_BLOCK) { return; }
+        }
+        else
+        {
+          m_sock.async_receive_blob(Blob_mutable(m_buf.data(), m_buf.size()),
+                                    [this](const Error_code& err_code, size_t sz)
+          {
+            // We're in thread W.
+            if (m_hop)
+            {
+              post(g_asio, [this, err_code, sz]()
+              {
+                if (on_response(err_code, sz))
+                {
+                  send_request();
+                }
+              });
+            }
+            else if (on_response(err_code, sz))
+            {
+              send_request();
+            }
+          });
+          return;
+        }
+      }
+      while (on_response(m_err_code, m_sz));
+    } // send_request()
 
-    Session::Channels chans;
-    session.sync_connect(session.mdt_builder(), nullptr, nullptr, &chans); // Let it throw on error.
-    FLOW_LOG_INFO("Session/channels opened.");
+    // Returns `true` if and only if the next request should be sent.
+    bool on_response(const Error_code& err_code, [[maybe_unused]] size_t sz)
+    {
+      const auto now = Fine_clock::now();
+      if (err_code) { throw Runtime_error(err_code, "run_echo():on_response()"); }
+      assert((sz == m_buf.size()) && "Server should have echoed our blob.");
+      const bool timed = m_batch_idx >= m_n_warmup;
+      if (timed)
+      {
+        m_rtts.push_back(now - m_msg_start);
+      }
+
+      if (++m_msg_idx != m_n_msgs)
+      {
+        return true;
+      }
+      // else: Batch done.
+      if (timed)
+      {
+        m_timed_total += now - m_batch_start;
+        m_batch_durs.push_back(now - m_batch_start);
+        m_timed_ctx_switches += process_ctx_switches() - m_batch_ctx_switches_start;
+        g_counters.stop();
+      }
+      if (++m_batch_idx == m_n_batches)
+      {
+        g_asio.stop(); // This is thread-safe, even if we're in thread W.
+        return false;
+      }
+      // else
+      m_msg_idx = 0;
+      if (m_batch_idx >= m_n_warmup)
+      {
+        g_counters.start();
+      }
+      m_batch_ctx_switches_start = process_ctx_switches();
+      m_batch_start = Fine_clock::now();
+      return true;
+    } // on_response()
+  }; // class Algo
 
-    assert(chans.size() == 2); // Server shall offer us 2 channels.  (We could also ask for some above, but we won't.)
+  Algo algo(logger_ptr, sock_ptr, opts, hop);
+  const auto work_guard = boost::asio::make_work_guard(g_asio); // See run_small_msgs_async_io().
+  post(g_asio, [&]() { algo.start_batch(); });
+  g_asio.run();
+  g_asio.restart();
+  g_asio.poll();
+  g_asio.restart();
 
-    auto& chan_raw = chans[0]; // Binary channel for raw-ish tests.
-    Channel_struc chan_struc(&(*log_logger), std::move(chans[1]), // Structured channel: SHM-backed underneath.
-                             ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM, &session);
+  Small_msgs_result result;
+  result.m_timed_total = algo.m_timed_total;
+  result.m_msgs_per_sec = double(opts.m_small_n_msgs) * double(opts.m_n_repeats)
+                            / (to_usec(algo.m_timed_total) / 1000000.);
+  result.m_ctx_switches_per_msg = double(algo.m_timed_ctx_switches)
+                                    / (double(opts.m_small_n_msgs) * double(opts.m_n_repeats));
+  result.m_counters = g_counters.take().per(double(opts.m_small_n_msgs) * double(opts.m_n_repeats));
+  result.m_batch_durs = std::move(algo.m_batch_durs);
+  result.m_lat = Latency_stats(std::move(algo.m_rtts));
+  return result;
+} // run_echo()
+
+std::vector<Stl_result> run_stl(flow::log::Logger* logger_ptr, Client_session* session_ptr, Channel_struc* chan_ptr,
+                                const Options& opts)
+{
+  using Kind = perf_demo::schema::GetStlReq::Kind;
+  using Stl = Shm_stl<Client_session, false>;
+  using std::vector;
 
-    run_capnp_over_raw(&(*std_logger), &chan_raw); // Benchmark 1.  capnp data transmission without Flow-IPC zero-copy.
-    run_capnp_zero_cpy(&(*std_logger), &chan_struc); // Benchmark 2.  Same but with it.
-
-    /* They already printed detailed timing info; now let's summarize the total results.  As you can see it
-     * just prints b1's RTT, b2's RTT, and the ratio; while reminding how much data was transmitted.
-     * (Ultimately b2's RTT will always be about the same and small; whereas b1's involves a bunch of copying
-     * into/out of tranport and hence will be proportional to data size.)
-     *
-     * The only subtlety is that we coarsen the RTT to be a multiple of 100us, rounding up.  Reason: It's not
-     * bulletproof, and it might be different on slower machines, but for now I've found this to be decent in practice:
-     * There's quite a bit of variation for a small message's RTT, maybe +/- 50us; and the total tends to be, if
-     * rounded to nearest 100us, at least 100us.  Furthermore, if sending small messages, sometimes there are
-     * paradoxical-ish results like b1-RTT/b2-RTT < 1, but really they're both around 100us, so it's more like 1.
-     * Once total_sz is increased beyond 10k-or-so, this stuff falls away and the coarsening to 100us-multiples
-     * doesn't really matter anyway and is easier to read.
-     *
-     * Maybe that's silliness.  In any case the un-coarsened detailed results are printed by run_*(); here
-     * we're summarizing.  @todo Revisit. */
-
-    const auto raw_rtt = ceil_div(round<microseconds>(g_capnp_over_raw_rtt).count(), microseconds::rep(100)) * 100;
-    const auto zcp_rtt = ceil_div(round<microseconds>(g_capnp_zero_cpy_rtt).count(), microseconds::rep(100)) * 100;
-
-    FLOW_LOG_INFO("Benchmark summary (rounded-up to 100-usec multiples): ");
-    FLOW_LOG_INFO("Transmission of ~[" << (g_total_sz / 1024) << " ki] of Cap'n Proto structured data: ");
-    FLOW_LOG_INFO("Via raw-local-stream-socket: RTT = [" << raw_rtt << " usec].");
-    FLOW_LOG_INFO("Via-zero-copy-Flow-IPC-channel ("
-#if JEM_ELSE_CLASSIC
-                  "SHM-jemalloc-backed"
-#else
-                  "SHM-classic-backed"
-#endif
-                  "): RTT = [" << zcp_rtt << " usec].");
-    FLOW_LOG_INFO("Ratio = [" << float(raw_rtt) / float(zcp_rtt) << "].");
+  FLOW_LOG_SET_CONTEXT(logger_ptr, flow::Flow_log_component::S_UNCAT);
 
-    FLOW_LOG_INFO("Exiting.");
-  } // try
-  catch (const exception& exc)
+  // Reminder: see main_srv.cpp Serve_algo::on_stl_request() counterpart.
+  vector<Stl_result> results;
+  for (const auto kind : { Kind::VECTOR, Kind::MAP, Kind::STRING })
   {
-    FLOW_LOG_WARNING("Caught exception: [" << exc.what() << "].");
-    FLOW_LOG_WARNING("(Perhaps you did not execute session-server executable in parallel, or "
-                     "you executed one or both of us oddly?)");
-    return 1;
+    for (const auto n_elems : opts.m_stl_n_elems_list)
+    {
+      for (const bool app_else_session_shm : { false, true })
+      {
+        const std::string kind_name = (kind == Kind::VECTOR) ? "vector" : ((kind == Kind::MAP) ? "map" : "string");
+        const std::string arena_name = app_else_session_shm ? "app_shm" : "session_shm";
+        FLOW_LOG_INFO("-- RUN - SHM-native STL container: build, lend/borrow, traverse "
+                      "([" << kind_name << "] of [" << n_elems << "] elements in [" << arena_name << "]) --");
+
+        Stl_result result;
+        switch (kind)
+        {
+        case Kind::VECTOR:
+          result = run_stl_one<Stl::Vector>(logger_ptr, session_ptr, chan_ptr, opts, kind, n_elems,
+                                            app_else_session_shm);
+          break;
+        case Kind::MAP:
+          result = run_stl_one<Stl::Map>(logger_ptr, session_ptr, chan_ptr, opts, kind, n_elems,
+                                         app_else_session_shm);
+          break;
+        case Kind::STRING:
+          result = run_stl_one<Stl::String>(logger_ptr, session_ptr, chan_ptr, opts, kind, n_elems,
+                                            app_else_session_shm);
+          break;
+        }
+        result.m_kind_name = kind_name;
+        result.m_n_elems = n_elems;
+        result.m_arena_name = arena_name;
+        results.push_back(std::move(result));
+      }
+    }
   }
+  return results;
+} // run_stl()
 
-  return 0;
-} // main()
+template<typename Container>
+Stl_result run_stl_one(flow::log::Logger* logger_ptr, Client_session* session_ptr, Channel_struc* chan_ptr,
+                       const Options& opts, perf_demo::schema::GetStlReq::Kind kind, size_t n_elems,
+                       bool app_else_session_shm)
+{
+  using flow::Flow_log_component;
+  using flow::Fine_clock;
+  using flow::Fine_duration;
+  using flow::Fine_time_pt;
+  using flow::log::Logger;
+  using flow::log::Log_context;
+  using boost::asio::post;
+  using boost::chrono::nanoseconds;
+  using std::vector;
+
+  /* Each iteration: request the container; server builds it and lends it to us (that's in the response); we borrow
+   * it and read all of it.  We time the RTT, the borrow, and the traversal; the server times the build and the lend;
+   * and the handle's transmission is what remains of the RTT after subtracting the server's time.  The total (RTT +
+   * borrow + traversal) is what it takes a client to get its hands on (and go through) the whole thing.
+   *
+   * Keep in mind the traversal is the first time this process touches the container's pages; so it includes the cost
+   * of faulting them into our address space (the SHM pool is mapped already, but not page by page).  That is part of
+   * the real cost of reading data received this way; and it's why the traversal tends to take longer than a
+   * traversal of the same container in the heap would. */
+
+  struct Algo :
+    public Log_context
+  {
+    Client_session& m_session;
+    Channel_struc& m_chan;
+    const perf_demo::schema::GetStlReq::Kind m_kind;
+    const size_t m_n_elems;
+    const bool m_app_else_session_shm;
+    const unsigned int m_n_warmup;
+    const unsigned int m_n_iters;
+    unsigned int m_iter_idx = 0;
+    Fine_time_pt m_req_start;
+    vector<Fine_duration> m_builds;
+    vector<Fine_duration> m_lends;
+    vector<Fine_duration> m_xmits;
+    vector<Fine_duration> m_borrows;
+    vector<Fine_duration> m_traverses;
+    vector<Fine_duration> m_totals;
+
+    Algo(Logger* logger_ptr, Client_session* session_ptr, Channel_struc* chan_ptr, const Options& opts,
+         perf_demo::schema::GetStlReq::Kind kind, size_t n_elems, bool app_else_session_shm) :
+      Log_context(logger_ptr, Flow_log_component::S_UNCAT),
+      m_session(*session_ptr),
+      m_chan(*chan_ptr),
+      m_kind(kind),
+      m_n_elems(n_elems),
+      m_app_else_session_shm(app_else_session_shm),
+      m_n_warmup(opts.m_n_warmup),
+      m_n_iters(opts.m_n_warmup + opts.m_n_repeats)
+    {
+      // Nothing else.
+    }
+
+    void send_request()
+    {
+      auto req = m_chan.create_msg();
+      auto req_root = req.body_root()->initGetStlReq();
+      req_root.setKind(m_kind);
+      req_root.setNElems(m_n_elems);
+      req_root.setAppElseSessionShm(m_app_else_session_shm);
+      if (m_iter_idx >= m_n_warmup)
+      {
+        g_counters.start();
+      }
+      m_req_start = Fine_clock::now();
+      m_chan.async_request(req, nullptr, nullptr,
+                           [this](Channel_struc::Msg_in_ptr&& rsp) { on_response(std::move(rsp)); });
+    }
+
+    void on_response(Channel_struc::Msg_in_ptr&& rsp)
+    {
+      const auto rtt = Fine_clock::now() - m_req_start;
+      const auto rsp_root = rsp->body_root().getGetStlRsp();
+
+      const auto borrow_start = Fine_clock::now();
+      Blob lend_blob;
+      ipc::transport::struc::shm::capnp_get_shm_handle_to_borrow(rsp_root.getHandle(), &lend_blob);
+      auto container = m_session.template borrow_object<Container>(lend_blob);
+      const auto traverse_start = Fine_clock::now();
+      if (!container)
+      {
+        // Per Flow-IPC docs: the session is hosed (server is gone?).
+        throw Runtime_error("STL benchmark: borrow_object() failed.");
+      }
+      const auto checksum = stl_checksum(*container);
+      const auto traverse_end = Fine_clock::now();
+      if (m_iter_idx >= m_n_warmup)
+      {
+        g_counters.stop();
+      }
+
+      if ((container->size() != m_n_elems) || (checksum != rsp_root.getChecksum()))
+      {
+        throw Runtime_error("Borrowed STL container does not look right... something is wrong.");
+      }
+      if (m_iter_idx >= m_n_warmup)
+      {
+        const Fine_duration srv_dur(nanoseconds(rsp_root.getServerNanos()));
+        m_builds.push_back(Fine_duration(nanoseconds(rsp_root.getBuildNanos())));
+        m_lends.push_back(Fine_duration(nanoseconds(rsp_root.getLendNanos())));
+        m_xmits.push_back(rtt - srv_dur);
+        m_borrows.push_back(traverse_start - borrow_start);
+        m_traverses.push_back(traverse_end - traverse_start);
+        m_totals.push_back(traverse_end - m_req_start);
+      }
+      // Return it (not timed); the server's handle is gone already; so this is what deallocates it.
+      container.reset();
+      rsp.reset();
+
+      // As in run_small_msgs(): no recursion to worry about; and no need for the extra trip through g_asio.
+      if (++m_iter_idx == m_n_iters)
+      {
+        g_asio.stop();
+      }
+      else
+      {
+        send_request();
+      }
+    } // on_response()
+  }; // class Algo
+
+  Algo algo(logger_ptr, session_ptr, chan_ptr, opts, kind, n_elems, app_else_session_shm);
+  post(g_asio, [&]() { algo.send_request(); });
+  run_asio();
+  g_asio.restart();
+  g_asio.poll();
+  g_asio.restart();
+
+  Stl_result result;
+  result.m_build = Latency_stats(std::move(algo.m_builds));
+  result.m_lend = Latency_stats(std::move(algo.m_lends));
+  result.m_xmit = Latency_stats(std::move(algo.m_xmits));
+  result.m_borrow = Latency_stats(std::move(algo.m_borrows));
+  result.m_traverse = Latency_stats(std::move(algo.m_traverses));
+  result.m_total_samples = algo.m_totals;
+  result.m_total = Latency_stats(std::move(algo.m_totals));
+  result.m_counters = g_counters.take().per(opts.m_n_repeats);
+  return result;
+} // run_stl_one()
+
+void prefault_shm(flow::log::Logger* logger_ptr, Client_session* session_ptr, Channel_struc* chan_ptr,
+                  const Options& opts)
+{
+  using Stl = Shm_stl<Client_session, false>;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, flow::Flow_log_component::S_UNCAT);
+
+  /* A fresh SHM pool's pages are faulted in (per process) only as they are first touched; and that'd be on the
+   * first iterations of the benchmarks, skewing those (and, with no warmup, the one-shot results).  So touch a bunch
+   * of them first: simply get the server to build (write) a big string in each arena, lend it to us; read all of it;
+   * and let it go.  That's exactly the STL benchmark's doing, minus the reporting.  After that, with SHM-classic, the
+   * pages stay faulted-in on both sides (deallocation leaves them in the pool, mapped); allocations of up to roughly
+   * that much will reuse them.  With SHM-jemalloc it's more of a best effort: its allocator may return freed pages to
+   * the OS at its discretion. */
+  Options prefault_opts = opts;
+  prefault_opts.m_n_warmup = 0;
+  prefault_opts.m_n_repeats = 1;
+  const size_t sz = opts.m_prefault_mi * 1024 * 1024;
+  for (const bool app_else_session_shm : { false, true })
+  {
+    FLOW_LOG_INFO("Prefaulting [" << opts.m_prefault_mi << " MiB] of [" << (app_else_session_shm ? "app" : "session")
+                  << "]-SHM pages (both sides).");
+    run_stl_one<Stl::String>(logger_ptr, session_ptr, chan_ptr, prefault_opts,
+                             perf_demo::schema::GetStlReq::Kind::STRING, sz, app_else_session_shm);
+  }
+  g_counters.take(); // Not a benchmark.
+  FLOW_LOG_INFO("Prefaulting done.");
+} // prefault_shm()
+
+void run_asio()
+{
+  run_event_loop(&g_asio, g_spin_usec, &g_spin_stats);
+}
+
+std::string repeats_str(const std::vector<flow::Fine_duration>& samples)
+{
+  std::ostringstream os;
+  os.setf(std::ios::fixed);
+  os.precision(1);
+  os << '[';
+  for (size_t idx = 0; idx != samples.size(); ++idx)
+  {
+    os << ((idx == 0) ? "" : " / ") << to_usec(samples[idx]);
+  }
+  os << "] usec";
+  return os.str();
+}
 
-void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
+std::vector<flow::Fine_duration> run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr,
+                                                    const Options& opts)
 {
   using flow::Flow_log_component;
+  using flow::Fine_duration;
   using flow::log::Logger;
   using flow::log::Log_context;
   using flow::util::ceil_div;
@@ -148,59 +2369,63 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
   using Capnp_word_array_array_ptr = kj::ArrayPtr<const Capnp_word_array_ptr>;
   using Capnp_heap_engine = ::capnp::SegmentArrayMessageReader;
 
-  /* Reminder: see main_srv.cpp run_capnp_over_raw() counterpart; we keep comments light except for client-specifics.
+  /* Reminder: see main_srv.cpp send_capnp_over_raw() counterpart; we keep comments light except for client-specifics.
    *
    * In particular the couple comments there about how we could've had simpler code, had we used this or that technique,
    * tends to apply more to *us* rather than main_srv.cpp counterpart (but to it too).  We have more receiving logic
    * including looping receiving, so we're a bit more complex; so those simplifications would've benefitted us more
-   * (while trading off other stuff... anyway see that comment in main_srv.cpp!). */
+   * (while trading off other stuff... anyway see that comment in main_srv.cpp!).
+   *
+   * We do opts.m_n_warmup + opts.m_n_repeats iterations of request/response, back to back, timing each; and return
+   * the RTTs of the latter ones. */
 
   struct Algo :
     public Log_context
   {
     Channel_raw& m_chan;
+    const unsigned int m_n_warmup;
+    const unsigned int m_n_iterations;
+    unsigned int m_iteration_idx = 0;
     Error_code m_err_code;
     size_t m_sz;
     size_t m_n;
     size_t m_n_segs;
+    /* The segments of the current response.  We reuse them (their buffers) from one iteration to the next:
+     * realistically a reader repeatedly receiving similar-sized stuff would do that; and otherwise each iteration
+     * would pay for page-faulting-in fresh heap pages (for large sizes at least) -- which would be a cold-start cost,
+     * not a steady-state one. */
     vector<Blob> m_segs;
-    bool m_new_seg_next = true;
+    size_t m_seg_idx;
+    bool m_new_seg_next;
     /* Server sends the stuff, but we time from just before sending request to just-after receiving and accessing reply.
      * Ctor call begins the timing; so wait until invoking it. */
     std::optional<Timer> m_timer;
+    vector<Fine_duration> m_rtts;
 
-    Algo(Logger* logger_ptr, Channel_raw* chan_ptr) :
+    Algo(Logger* logger_ptr, Channel_raw* chan_ptr, const Options& opts) :
       Log_context(logger_ptr, Flow_log_component::S_UNCAT),
-      m_chan(*chan_ptr)      
+      m_chan(*chan_ptr),
+      m_n_warmup(opts.m_n_warmup),
+      m_n_iterations(opts.m_n_warmup + opts.m_n_repeats)
     {
       FLOW_LOG_INFO("-- RUN - capnp request/response over raw local-socket connection --");
+      m_rtts.reserve(opts.m_n_repeats);
     }
 
-    void start()
+    void start_iteration()
     {
-      m_chan.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
-      m_chan.start_send_blob_ops(ev_wait);
-      m_chan.start_receive_blob_ops(ev_wait);
-
-      FLOW_LOG_INFO("< Expecting handshake SYN for initialization sync.");
-      m_chan.async_receive_blob(Blob_mutable(&m_n, sizeof(m_n)), &m_err_code, &m_sz,
-                                [&](const Error_code& err_code, size_t) { on_sync(err_code); });
-      if (m_err_code != ipc::transport::error::Code::S_SYNC_IO_WOULD_BLOCK) { on_sync(m_err_code); }
-    }
-
-    void on_sync(const Error_code& err_code)
-    {
-      if (err_code) { throw Runtime_error(err_code, "run_capnp_over_raw():on_sync()"); }
-
-      // Send a dummy message as a request signal, so we can start timing RTT before sending it.
-      FLOW_LOG_INFO("= Got handshake SYN.");
-
-      FLOW_LOG_INFO("> Issuing get-cache request via tiny message.");
+      // Send a (control) message as a request signal, so we can start timing RTT before sending it.
+      FLOW_LOG_TRACE("> Issuing get-cache request via tiny message.");
+      if (m_iteration_idx >= m_n_warmup)
+      {
+        g_counters.start();
+      }
       m_timer.emplace(get_logger(), "capnp-raw", Timer::real_clock_types(), 100); // Begin timing.
-      m_chan.send_blob(Blob_const(&m_n, sizeof(m_n)));
+      const Ctl_msg req{ Ctl_msg::Cmd::S_GET_CACHE_RAW, 0 };
+      m_chan.send_blob(Blob_const(&req, sizeof(req)));
       m_timer->checkpoint("sent request");
 
-      FLOW_LOG_INFO("< Expecting get-cache response fragment: capnp segment count.");
+      FLOW_LOG_TRACE("< Expecting get-cache response fragment: capnp segment count.");
       m_chan.async_receive_blob(Blob_mutable(&m_n, sizeof(m_n)), &m_err_code, &m_sz,
                                 [&](const Error_code& err_code, size_t sz) { on_n_segs(err_code, sz); });
       if (m_err_code != ipc::transport::error::Code::S_SYNC_IO_WOULD_BLOCK) { on_n_segs(m_err_code, m_sz); }
@@ -213,11 +2438,13 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
       assert(m_n != 0);
 
       m_n_segs = m_n;
-      FLOW_LOG_INFO("= Got get-cache response fragment: capnp segment count = [" << m_n_segs << "].");
-      FLOW_LOG_INFO("< Expecting get-cache response fragments x N: [seg size, seg content...].");
+      FLOW_LOG_TRACE("= Got get-cache response fragment: capnp segment count = [" << m_n_segs << "].");
+      FLOW_LOG_TRACE("< Expecting get-cache response fragments x N: [seg size, seg content...].");
       m_timer->checkpoint("got seg-count");
 
       m_segs.reserve(m_n_segs);
+      m_seg_idx = 0;
+      m_new_seg_next = true;
 
       /* This is where the looping-read code is, and where we need to be careful to not start
        * a recursion-loop (stack overflows-oh my) but rather an iteration-loop.  That is, if an async_X() yields
@@ -234,7 +2461,6 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
        * its .size() = how many bytes we've filled out already.  (It is formally allowed to write into the area
        * [.end(), .begin() + capacity()).)
        */
-      assert(m_new_seg_next);
       read_segs();
     }
 
@@ -249,7 +2475,7 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
         }
         else
         {
-          auto& seg = m_segs.back();
+          auto& seg = m_segs[m_seg_idx];
           m_chan.async_receive_blob(Blob_mutable(seg.end(), seg.capacity() - seg.size()), &m_err_code, &m_sz,
                                     [&](const Error_code& err_code, size_t sz) { on_blob(err_code, sz); });
         }
@@ -274,24 +2500,33 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
         m_new_seg_next = false;
         assert(m_n != 0);
 
-        // New segment's size known; reserve the space and then set .size() = 0, while leaving .capacity() same.
-        m_segs.emplace_back(m_n);
-        m_segs.back().clear();
-        assert(m_segs.back().capacity() == m_n); // Ensure it didn't dealloc.
+        /* New segment's size known; reserve the space (unless a previous iteration already did, for this segment)
+         * and then set .size() = 0, while leaving .capacity() same. */
+        if (m_seg_idx == m_segs.size())
+        {
+          m_segs.emplace_back(m_n);
+        }
+        else if (m_segs[m_seg_idx].capacity() != m_n)
+        {
+          m_segs[m_seg_idx] = Blob(m_n);
+        }
+        auto& seg = m_segs[m_seg_idx];
+        seg.clear();
+        assert(seg.capacity() == m_n); // Ensure it didn't dealloc.
       }
       else
       {
         // Register the received bytes; then see if we finished the segment with that; or maybe even the last one.
-        auto& seg = m_segs.back();
+        auto& seg = m_segs[m_seg_idx];
         seg.resize(seg.size() + sz);
         if (seg.size() == seg.capacity())
         {
           // It's e.g. 15 extra lines; let's not poison timing with that unless console logger turned up to TRACE+.
-          FLOW_LOG_TRACE("= Got segment [" << m_segs.size() << "] of [" << m_n_segs << "]; "
+          FLOW_LOG_TRACE("= Got segment [" << (m_seg_idx + 1) << "] of [" << m_n_segs << "]; "
                          "segment serialization size (capnp-decided) = "
                          "[" << ceil_div(seg.size(), size_t(1024)) << " Ki].");
 
-          if (m_segs.size() == m_n_segs)
+          if (++m_seg_idx == m_n_segs)
           {
             m_timer->checkpoint("got last seg");
             on_complete_response(); // Yay!  Next step of algo.
@@ -310,10 +2545,11 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
       /* Now for vanilla Cap'n Proto work: We have the segments; use SegmentArrayMessageReader as normal to
        * interpret it into a capnp-backed structured message. */
       vector<Capnp_word_array_ptr> capnp_segs;
-      capnp_segs.reserve(m_segs.size());
+      capnp_segs.reserve(m_n_segs);
 
-      for (const auto& seg : m_segs)
+      for (size_t idx = 0; idx != m_n_segs; ++idx)
       {
+        const auto& seg = m_segs[idx];
         capnp_segs.emplace_back(reinterpret_cast<const word*>(seg.const_data()), // uint8_t* -> word*.
                                 seg.size() / sizeof(word));
       }
@@ -327,70 +2563,98 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
       const auto rsp_root = capnp_msg.getRoot<perf_demo::schema::Body>().getGetCacheRsp();
 
       m_timer->checkpoint("accessed deserialization root");
+      // Timing done.  The rest is not timed.
+      if (m_iteration_idx >= m_n_warmup)
+      {
+        g_counters.stop();
+        m_rtts.push_back(m_timer->since_start().m_values[size_t(Clock_type::S_REAL_HI_RES)]);
+      }
 
-      FLOW_LOG_INFO("= Done.  Total received size = "
-                    "[" << ceil_div(capnp_msg.sizeInWords() * sizeof(word), size_t(1024 * 1024)) << " Mi].  "
-                    "Will verify contents (sizes, hashes).");
+      if (m_iteration_idx == 0)
+      {
+        // Verifying every time would be slow for large sizes, and it's the same data each time anyway.
+        FLOW_LOG_INFO("= Done.  Total received size = "
+                      "[" << ceil_div(capnp_msg.sizeInWords() * sizeof(word), size_t(1024 * 1024)) << " Mi].  "
+                      "Will verify contents (sizes, hashes).");
 
-      verify_rsp(rsp_root);
+        verify_rsp(rsp_root);
+        FLOW_LOG_INFO("= Contents look good.");
+      }
+      if (m_n_iterations == 1)
+      {
+        FLOW_LOG_INFO("= Timing results: [\n" << m_timer.value() << "\n].");
+      }
+      else
+      {
+        FLOW_LOG_TRACE("= Timing results: [\n" << m_timer.value() << "\n].");
+      }
 
-      FLOW_LOG_INFO("= Contents look good.  Timing results: [\n" << m_timer.value() << "\n].");
-      g_capnp_over_raw_rtt = m_timer->since_start().m_values[size_t(Clock_type::S_REAL_HI_RES)];
+      if (++m_iteration_idx == m_n_iterations)
+      {
+        /* The .stop() is needed here, because the struc::Channel (which shares g_asio with us) is always reading all
+         * internally incoming messages ASAP; so it always has an .async_wait() outstanding.  Hence the .run() never
+         * runs out of work, unless we flip the g_asio internal "is-stopped" switch. */
+        g_asio.stop();
+      }
+      else
+      {
+        // Post it, as opposed to calling directly, so as not to recurse -- including into ourselves.
+        post(g_asio, [this]() { start_iteration(); });
+      }
     } // on_complete_response()
   }; // class Algo
 
-  Algo algo(logger_ptr, chan_ptr);
-  post(g_asio, [&]() { algo.start(); });
-  g_asio.run();
+  Algo algo(logger_ptr, chan_ptr, opts);
+  post(g_asio, [&]() { algo.start_iteration(); });
+  run_asio();
   g_asio.restart();
+  g_asio.poll();
+  g_asio.restart();
+  return std::move(algo.m_rtts);
 } // run_capnp_over_raw()
 
-void run_capnp_zero_cpy([[maybe_unused]] flow::log::Logger* logger_ptr, Channel_struc* chan_ptr)
+std::vector<flow::Fine_duration> run_capnp_zero_cpy(flow::log::Logger* logger_ptr, Channel_struc* chan_ptr,
+                                                    const Options& opts)
 {
   using flow::Flow_log_component;
+  using flow::Fine_duration;
   using flow::log::Logger;
   using flow::log::Log_context;
-  using ::capnp::word;
   using boost::asio::post;
+  using std::vector;
 
-  // Reminder: see main_srv.cpp run_capnp_zero_cpy() counterpart; we keep comments light except for client-specifics.
+  // Reminder: see main_srv.cpp serve() counterpart; we keep comments light except for client-specifics.
 
   struct Algo :
     public Log_context
   {
     Channel_struc& m_chan;
+    const unsigned int m_n_warmup;
+    const unsigned int m_n_iterations;
+    unsigned int m_iteration_idx = 0;
     std::optional<Timer> m_timer;
+    vector<Fine_duration> m_rtts;
 
-    Algo(Logger* logger_ptr, Channel_struc* chan_ptr) :
+    Algo(Logger* logger_ptr, Channel_struc* chan_ptr, const Options& opts) :
       Log_context(logger_ptr, Flow_log_component::S_UNCAT),
-      m_chan(*chan_ptr)      
+      m_chan(*chan_ptr),
+      m_n_warmup(opts.m_n_warmup),
+      m_n_iterations(opts.m_n_warmup + opts.m_n_repeats)
     {
       FLOW_LOG_INFO("-- RUN - zero-copy (SHM-backed) capnp request/response using Flow-IPC --");
+      m_rtts.reserve(opts.m_n_repeats);
     }
 
-    void start()
+    void start_iteration()
     {
-      m_chan.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
-      m_chan.start_ops(ev_wait);
-      m_chan.start_and_poll([](const Error_code&) {});
-
-      // Receive a dummy message to synchronize initialization.
-      FLOW_LOG_INFO("< Expecting handshake SYN for initialization sync.");
-      Channel_struc::Msg_in_ptr req;
-      m_chan.expect_msg(Channel_struc::Msg_which_in::GET_CACHE_REQ, &req,
-                        [&](auto&&) { on_sync(); });
-      if (req) { on_sync(); }
-    }
-
-    void on_sync()
-    {
-      // Send a dummy message as a request signal, so we can start timing RTT before sending it.
-      FLOW_LOG_INFO("= Got handshake SYN.");
-
       auto req = m_chan.create_msg();
       req.body_root()->initGetCacheReq().setFileName("file.bin");
 
-      FLOW_LOG_INFO("> Issuing get-cache request: [" << req << "].");
+      FLOW_LOG_TRACE("> Issuing get-cache request: [" << req << "].");
+      if (m_iteration_idx >= m_n_warmup)
+      {
+        g_counters.start();
+      }
       m_timer.emplace(get_logger(), "capnp-flow-ipc-e2e-zero-copy", Timer::real_clock_types(), 100);
 
       m_chan.async_request(req, nullptr, nullptr,
@@ -403,25 +2667,47 @@ void run_capnp_zero_cpy([[maybe_unused]] flow::log::Logger* logger_ptr, Channel_
       const auto rsp_root = rsp->body_root().getGetCacheRsp();
 
       m_timer->checkpoint("accessed deserialization root");
+      // Timing done.  The rest is not timed.
+      if (m_iteration_idx >= m_n_warmup)
+      {
+        g_counters.stop();
+        m_rtts.push_back(m_timer->since_start().m_values[size_t(Clock_type::S_REAL_HI_RES)]);
+      }
 
-      FLOW_LOG_INFO("= Done.  Will verify contents (sizes, hashes).");
-
-      verify_rsp(rsp_root);
-
-      FLOW_LOG_INFO("= Contents look good.  Timing results: [\n" << m_timer.value() << "\n].");
-      g_capnp_zero_cpy_rtt = m_timer->since_start().m_values[size_t(Clock_type::S_REAL_HI_RES)];
+      if (m_iteration_idx == 0)
+      {
+        FLOW_LOG_INFO("= Done.  Will verify contents (sizes, hashes).");
+        verify_rsp(rsp_root);
+        FLOW_LOG_INFO("= Contents look good.");
+      }
+      if (m_n_iterations == 1)
+      {
+        FLOW_LOG_INFO("= Timing results: [\n" << m_timer.value() << "\n].");
+      }
+      else
+      {
+        FLOW_LOG_TRACE("= Timing results: [\n" << m_timer.value() << "\n].");
+      }
 
       rsp.reset();
-      g_asio.stop();
+      if (++m_iteration_idx == m_n_iterations)
+      {
+        g_asio.stop();
+      }
+      else
+      {
+        post(g_asio, [this]() { start_iteration(); });
+      }
     } // on_complete_response()
   }; // class Algo
 
-  Algo algo(logger_ptr, chan_ptr);
-  post(g_asio, [&]() { algo.start(); });
-  g_asio.run();
+  Algo algo(logger_ptr, chan_ptr, opts);
+  post(g_asio, [&]() { algo.start_iteration(); });
+  run_asio();
   g_asio.restart();
   g_asio.poll();
   g_asio.restart();
+  return std::move(algo.m_rtts);
 } // run_capnp_zero_cpy()
 
 void verify_rsp(const perf_demo::schema::GetCacheRsp::Reader& rsp_root)
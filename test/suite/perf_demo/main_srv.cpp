@@ -16,12 +16,20 @@
  * permissions and limitations under the License. */
 
 #include "common.hpp"
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
 
 /* perf_demo_srv (this guy) and perf_demo_cli (main_cli.cpp) are two programs to be executed from
  * the same CWD, where they should both be placed.  First run the server program; once it says one can now
- * connect, start the client program.  (The server program has some optional args, including one controlling the
- * size of the transmitted data; it'll print the usage message at the top always.)  Launching the client
- * will begin the benchmark run; once it is done, both programs will exit.  The client's console shall print
+ * connect, start the client program.  (Both programs have some optional args, including ones controlling the
+ * size(s) of the transmitted data; `--help` prints the usage message.)  Launching the client
+ * will begin the benchmark run; the client drives it, telling the server what to do via small control messages
+ * (see Ctl_msg in common.hpp); once it is done, both programs will exit.  The client's console shall print
  * a benchmark summary.
  *
  * If macro JEM_ELSE_CLASSIC is set to 1, the SHM-provider providing zero-copy mechanics (internally) will be
@@ -53,7 +61,6 @@
  * currently common.[hc]pp) in the meta-app should morph into a more beautiful thing.  Please keep
  * this in mind when/if expanding this meta-application. */
 
-using Session = Session_server::Server_session_obj;
 // For when we test "classic" use of Cap'n Proto (capnp), sans Flow-IPC structured-transport layer.
 using Capnp_heap_engine = ::capnp::MallocMessageBuilder;
 
@@ -68,37 +75,46 @@ using Capnp_heap_engine = ::capnp::MallocMessageBuilder;
  * It doesn't need to be global; it's just for coding expediency (for now at least), as it's referenced in a few
  * benchmarks.  Same with g_capnp_msg. */
 static Task_engine g_asio;
-/* This is where we keep large capnp-structured data.  We fill it up at the start of main(), and at least one benchmark
- * transmits its backing serialization capnp-segments over an IPC channel (local stream socket).  Then at least one
- * other benchmark *deep-copies* it into a Flow-IPC SHM-backed MessageBuilder (*not* a capnp::MallocMessageBuilder like
- * this guy) and sends that.  If we add more benchmarks that need large capnp-structured data, we'll likely similarly
- * deep-copy this into whatever MessageBuilder is applicable. */
-static Capnp_heap_engine g_capnp_msg;
-
-void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan);
-void run_capnp_zero_copy(flow::log::Logger* logger_ptr, Channel_struc* chan, Session* session_ptr);
+/* This is where we keep large capnp-structured data.  We fill it up at the start of main() and possibly again later
+ * (with a different size), when the client asks for it via Ctl_msg::Cmd::S_PREP_CAPNP; e.g., during a payload-size
+ * sweep.  At least one benchmark transmits its backing serialization capnp-segments over an IPC channel (local stream
+ * socket).  Then at least one other benchmark *deep-copies* it into a Flow-IPC SHM-backed MessageBuilder (*not* a
+ * capnp::MallocMessageBuilder like this guy) and sends that.  If we add more benchmarks that need large
+ * capnp-structured data, we'll likely similarly deep-copy this into whatever MessageBuilder is applicable.
+ * (It's in an `optional` only because a MessageBuilder cannot be cleared; so to re-fill we re-construct.) */
+static std::optional<Capnp_heap_engine> g_capnp_msg;
+
+size_t prep_capnp_msg(flow::log::Logger* logger_ptr, size_t total_sz);
+void serve(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts);
+void send_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr);
 
 int main(int argc, char const * const * argv)
 {
   using flow::log::Simple_ostream_logger;
   using flow::log::Async_file_logger;
   using flow::Flow_log_component;
-  using flow::util::String_view;
-  using flow::util::ceil_div;
-  using boost::promise;
-  using boost::lexical_cast;
   using std::exception;
   using std::optional;
 
-  constexpr float TOTAL_SZ_MI = 1 * 1000;
+  Options opts;
+  const auto parse_result = parse_options(&opts, argc, argv, true);
+  if (parse_result != Parse_result::S_RUN)
+  {
+    return (parse_result == Parse_result::S_HELP) ? 0 : 1;
+  }
+  if (!pin_to_cpus(opts))
+  {
+    return 1;
+  }
 
   /* Set up logging within this function.  We could easily just use `cout` and `cerr` instead, but this
    * Flow stuff will give us time stamps and such for free, so why not?  Normally, one derives from
    * Log_context to do this very trivially, but we just have the one function, main(), so far so: */
   optional<Simple_ostream_logger> std_logger;
   optional<Async_file_logger> log_logger;
-  setup_logging(&std_logger, &log_logger, argc, argv, true);
+  setup_logging(&std_logger, &log_logger, opts, true);
   FLOW_LOG_SET_CONTEXT(&(*std_logger), Flow_log_component::S_UNCAT);
+  FLOW_LOG_INFO("Pinned to CPUs: [" << cpus_str(opts) << "].");
 
 #if JEM_ELSE_CLASSIC
   /* Instructed to do so by ipc::session::shm::arena_lend public docs (short version: this is basically a global,
@@ -111,149 +127,791 @@ int main(int argc, char const * const * argv)
   {
     ensure_run_env(argv[0], true);
 
+    /* Fill out vanilla capnp::MallocMessageBuilder g_capnp_msg with a whole bunch of data.  (See prep_capnp_msg().)
+     * The client may later ask for a different size (and then we'll re-fill it), but by default it just uses this. */
+    FLOW_LOG_INFO("Prep: Patience!  No need to try running client until we say server is up.");
+    prep_capnp_msg(&(*std_logger), size_t(opts.m_total_sz_mi * 1024.f * 1024.f));
+
+    /* Accept sessions and service whatever benchmarks their clients run, until the (driving) client says it is
+     * done.  Usually there's just the one session; but multi-client benchmarks involve more. */
+    serve(&(*std_logger), &(*log_logger), opts);
+
+    FLOW_LOG_INFO("Exiting.");
+  } // try
+  catch (const exception& exc)
+  {
+    FLOW_LOG_WARNING("Caught exception: [" << exc.what() << "].");
+    return 1;
+  }
+
+  return 0;
+} // main()
+
+size_t prep_capnp_msg(flow::log::Logger* logger_ptr, size_t total_sz)
+{
+  using flow::Flow_log_component;
+  using flow::util::String_view;
+  using flow::util::ceil_div;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+
+  /* Fill out vanilla capnp::MallocMessageBuilder g_capnp_msg with a whole bunch of data.
+   * A given benchmark can then transmit this directly; or prepare a perhaps-non-vanilla MessageBuilder
+   * (perhaps a fancy Flow-IPC SHM-backed one!) and deep-copy this guy into that, for identical data
+   * that the opposing side can (upon receipt) access and verify using the exact same code.
+   *
+   * See schema.capnp: It's a simple example structure that mimics a file cache server perhaps;
+   * there are N "file-parts"; within each file-part is a blob of bytes (the data) plus a couple fields the client
+   * can use to verify (size, hash) the data.
+   *
+   * So a benchmark run might essentially time something like this:
+   *   - We prepare a response structure, simulating the act of (e.g.) already having file-read or downloaded
+   *     the file (all its file-parts) into memory earlier.
+   *   - Client informs us of the size it wants (Ctl_msg::Cmd::S_PREP_CAPNP); we prepare it (here) and acknowledge.
+   *   - [Client (they) issue a short message, the get-cache-request.
+   *   - We receive it and immediately response with the prepared structure as the get-cache-response message.
+   *   - Client receives the short message and briefly accesses some part of it.]
+   *   - Client has *timed* the parts in [brackets] above.  That's the RTT result of the benchmark.  So it prints
+   *     that result (or, if it repeats the [brackets] part N times, the distribution of the N results).
+   *   - Client then runs through the whole structure and checks file-part hashes and sizes and what-not.
+   *
+   * So g_capnp_msg will be the "gold copy" of the data structure being used in such benchmarks.
+   * Note that this is *completely* vanilla capnp-using code; there's nothing Flow-IPC-ish going on here
+   * at all.  Even the backing MessageBuilder is just good ol' capnp::MallocMessageBuilder. */
+  FLOW_LOG_INFO("Prep: Filling capnp MallocMessageBuilder (rough size [" << total_sz << " bytes]): START.");
+  /* Small sizes (e.g., low end of a client's payload-size sweep) get a single file-part of exactly that size;
+   * otherwise it's 16Ki per file-part, as a real file cache might do. */
+  const size_t file_part_sz = std::min(size_t(16 * 1024), std::max(total_sz, size_t(1)));
+
+  g_capnp_msg.emplace();
+  auto file_parts_list = g_capnp_msg->initRoot<perf_demo::schema::Body>().initGetCacheRsp()
+                           .initFileParts(ceil_div(std::max(total_sz, size_t(1)), file_part_sz));
+  for (size_t idx = 0; idx != file_parts_list.size(); ++idx)
+  {
+    auto file_part = file_parts_list[idx];
+    auto data = file_part.initData(file_part_sz);
+    for (size_t byte_idx = 0; byte_idx != file_part_sz; ++byte_idx)
+    {
+      data[byte_idx] = uint8_t(byte_idx % 256); // Dummy data... let's not just leave it as zeroes.
+    }
+    file_part.setDataSizeToVerify(file_part_sz);
+    /* Obviously a Boost string hash is not a cryptographically sound hash.  Fine for our purposes
+     * of sanity-checking that whatever the client received and accessed was at least mutually consistent nad
+     * not junk that accidentally didn't cause capnp to throw an exception during an accessor. */
+    file_part.setDataHashToVerify(boost::hash<String_view>()
+                                    (String_view(reinterpret_cast<const char*>(data.begin()), file_part_sz)));
+  }
+
+  /* Note total_sz is just a rough guide; we only count the GetCacheRsp.data field as "taking space";
+   * there's also nearby hash and size fields, plus capnp format overhead.  That said even with small
+   * sizes like 10kib it's a pretty decent estimate, it turns out.  (And it's certainly proportional at least.) */
+
+  const auto data_sz = file_parts_list.size() * file_part_sz;
+  FLOW_LOG_INFO("Prep: Filling capnp MallocMessageBuilder: DONE (exact data size [" << data_sz << " bytes]).");
+  return data_sz;
+} // prep_capnp_msg()
+
+/* The start line of multi-client benchmarks (see Ctl_msg::Cmd::S_BARRIER), shared by all sessions: for each session
+ * whose client is currently waiting at it, the function that releases it (sends it the given reply); keyed by that
+ * session's Serve_algo, so that a session that ends (see Accept_algo::on_session_done()) can be taken off.  (Else its
+ * function would refer to a dead Serve_algo; and it'd count toward the next group's size.) */
+struct Load_barrier
+{
+  std::map<const void*, std::function<void (const Ctl_msg&)>> m_waiters;
+};
+
+/* The algorithm serving one session (see serve()) of transport S_TRANSPORT.  Unlike the other Algos in this meta-app
+ * this one is not a local class inside its function: it serves structured channels of more than one type (heap-backed
+ * and SHM-backed serialization), so it needs member templates; and a local class cannot have those.  Otherwise it's
+ * the same deal: functions are arranged in chronological order, top-down. */
+template<Transport S_TRANSPORT>
+struct Serve_algo :
+  public flow::log::Log_context
+{
+  using Session = typename Transport_types<S_TRANSPORT>::Session_server::Server_session_obj;
+  using Channel_raw = typename Transport_types<S_TRANSPORT>::Channel_raw;
+  using Channel_struc = typename Transport_types<S_TRANSPORT>::Channel_struc;
+  using Channel_struc_heap = typename Transport_types<S_TRANSPORT>::Channel_struc_heap;
+
+  /* In small-message ping-pong mode each response carries this much file-part data; so the whole response,
+   * like the request, is well under 256 bytes. */
+  static constexpr size_t S_SMALL_RSP_DATA_SZ = 64;
+
+  Channel_raw& m_chan_raw;
+  Channel_struc& m_chan_struc;
+  // These are null, unless S_TRANSPORT is S_SOCKET.  (See Chan_idx.)
+  Channel_struc_heap* const m_chan_struc_heap;
+  Channel_struc* const m_chan_struc_app;
+  Channel_struc* const m_chan_struc_async;
+  Session& m_session;
+  Load_barrier& m_barrier;
+  /* Invoked when client says its session is done (but server is not); or when the client is gone (see handle_ctl()).
+   * Must not synchronously destroy `*this`. */
+  const std::function<void ()> m_on_done_func;
+  Error_code m_err_code;
+  size_t m_sz;
+  Ctl_msg m_ctl;
+  /* The SHM-backed copy of g_capnp_msg.  It's prepared on request (S_PREP_CAPNP), not up-front: in multi-client
+   * benchmarks there can be dozens of sessions that'll never need it; and deep-copying a large g_capnp_msg into
+   * each one's SHM would take forever. */
+  typename Channel_struc::Msg_out m_capnp_msg;
+  bool m_capnp_msg_prepped = false;
+  /* Whether we're in small-message mode (see Ctl_msg::Cmd::S_SMALL_MSGS); if so the streaming batch size
+   * (0 = ping-pong), GetCacheReqs received so far in the current batch, and the end-of-batch message to send.
+   * (The latter is separate from m_ctl, as that one is the target of the outstanding Ctl_msg receive.) */
+  bool m_small_mode = false;
+  size_t m_small_stream_n = 0;
+  size_t m_small_stream_count = 0;
+  Ctl_msg m_small_stream_ack;
+
+  Serve_algo(flow::log::Logger* logger_ptr, Channel_raw* chan_raw_ptr, Channel_struc* chan_struc_ptr,
+             Channel_struc_heap* chan_struc_heap_ptr, Channel_struc* chan_struc_app_ptr,
+             Channel_struc* chan_struc_async_ptr, Session* session_ptr,
+             Load_barrier* barrier_ptr, std::function<void ()>&& on_done_func) :
+    flow::log::Log_context(logger_ptr, flow::Flow_log_component::S_UNCAT),
+    m_chan_raw(*chan_raw_ptr),
+    m_chan_struc(*chan_struc_ptr),
+    m_chan_struc_heap(chan_struc_heap_ptr),
+    m_chan_struc_app(chan_struc_app_ptr),
+    m_chan_struc_async(chan_struc_async_ptr),
+    m_session(*session_ptr),
+    m_barrier(*barrier_ptr),
+    m_on_done_func(std::move(on_done_func))
+  {
+    FLOW_LOG_INFO("-- SERVE - request/response benchmarks, as driven by client "
+                  "(transport [" << transport_name(S_TRANSPORT) << "]) --");
+  }
+
+  void start()
+  {
+    /* sync_io-pattern API: Drop-in our async-wait provider which is good ol' boost.asio .async_wait()
+     * over g_asio.  After this we can do sends and receives.  send()s in Flow-IPC are always synchronous,
+     * non-blocking, and never yield would-block.  Receives naturally are asynchronous; in sync_io pattern
+     * that means you give async_X() both a handler F to run later, if right now would-block results; and
+     * the out-args to set if the result is available synchronously right now.  So either one happens, or
+     * the other.  It's straightforward really, with one caveat to watch out for: avoid arbitrary-level
+     * recursive when reading looping data.  That applies to us reading Ctl_msg after Ctl_msg; see read_ctl(). */
+    m_chan_raw.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+    m_chan_raw.start_send_blob_ops(ev_wait);
+    m_chan_raw.start_receive_blob_ops(ev_wait);
+
+    start_struc(&m_chan_struc);
     {
-      const auto total_sz_mi = (argc >= 2) ? lexical_cast<float>(argv[1]) : TOTAL_SZ_MI;
-
-      /* Fill out vanilla capnp::MallocMessageBuilder g_capnp_msg with a whole bunch of data.
-       * A given benchmark can then transmit this directly; or prepare a perhaps-non-vanilla MessageBuilder
-       * (perhaps a fancy Flow-IPC SHM-backed one!) and deep-copy this guy into that, for identical data
-       * that the opposing side can (upon receipt) access and verify using the exact same code.
-       *
-       * See schema.capnp: It's a simple example structure that mimics a file cache server perhaps;
-       * there are N "file-parts"; within each file-part is a blob of bytes (the data) plus a couple fields the client
-       * can use to verify (size, hash) the data.
-       *
-       * So a benchmark run might essentially time something like this:
-       *   - We prepare a response structure, simulating the act of (e.g.) already having file-read or downloaded
-       *     the file (all its file-parts) into memory earlier.
-       *   - We inform client (them) we're ready for the benchmark (via short message).
-       *   - [Client (they) issue a short message, the get-cache-request.
-       *   - We receive it and immediately response with the prepared structure as the get-cache-response message.
-       *   - Client receives the short message and briefly accesses some part of it.]
-       *   - Client has *timed* the parts in [brackets] above.  That's the RTT result of the benchmark.  So it prints
-       *     that result.
-       *   - Client then runs through the whole structure and checks file-part hashes and sizes and what-not.
-       *
-       * So g_capnp_msg will be the "gold copy" of the data structure being used in such benchmarks.
-       * Note that this is *completely* vanilla capnp-using code; there's nothing Flow-IPC-ish going on here
-       * at all.  Even the backing MessageBuilder is just good ol' capnp::MallocMessageBuilder. */
-      FLOW_LOG_INFO("Prep: Patience!  No need to try running client until we say server is up.");
-      FLOW_LOG_INFO("Prep: Filling capnp MallocMessageBuilder (rough size [" << total_sz_mi << " Mi]): START.");
-      constexpr size_t FILE_PART_SZ = 16 * 1024;
-
-      auto file_parts_list = g_capnp_msg.initRoot<perf_demo::schema::Body>().initGetCacheRsp()
-                               .initFileParts
-                                  (ceil_div(size_t(total_sz_mi * 1024.f * 1024.f), FILE_PART_SZ));
-      for (size_t idx = 0; idx != file_parts_list.size(); ++idx)
+      // This one also takes the SHM-native STL benchmark's requests.
+      typename Channel_struc::Msgs_in reqs;
+      m_chan_struc.expect_msgs(Channel_struc::Msg_which_in::GET_STL_REQ, &reqs,
+                               [this](typename Channel_struc::Msg_in_ptr&& req)
+      {
+        on_stl_request(std::move(req));
+      });
+      for (auto& req : reqs)
       {
-        auto file_part = file_parts_list[idx];
-        auto data = file_part.initData(FILE_PART_SZ);
-        for (size_t byte_idx = 0; byte_idx != FILE_PART_SZ; ++byte_idx)
+        on_stl_request(std::move(req));
+      }
+    }
+    if (m_chan_struc_heap)
+    {
+      start_struc(m_chan_struc_heap);
+      start_struc(m_chan_struc_app);
+      /* Client uses this one via async-I/O API, not sync_io; that's all the same to us.  Other than that it's just
+       * like m_chan_struc. */
+      start_struc(m_chan_struc_async);
+    }
+
+    FLOW_LOG_INFO("< Expecting control messages (including get-cache requests of raw benchmark).");
+    read_ctl();
+  } // start()
+
+  template<typename Channel_struc_t>
+  void start_struc(Channel_struc_t* chan_ptr)
+  {
+    auto& chan = *chan_ptr;
+    chan.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+    chan.start_ops(ev_wait);
+    chan.start_and_poll([](const Error_code&) {});
+
+    /* Unlike the raw channel, where to avoid unnecessary code, we accept any (Ctl_msg) message as a request --
+     * here we require GetCacheReq specifically (hence the Msg_which_in::GET_CACHE_REQ arg value below).
+     * We don't check its contents.  If you're keeping score we're doing some stuff here that the raw path
+     * entirely skips... but good enough for our purposes, we think; at least we're not skewing results in
+     * Flow-IPC's favor. */
+    typename Channel_struc_t::Msgs_in reqs;
+    chan.expect_msgs(Channel_struc_t::Msg_which_in::GET_CACHE_REQ, &reqs,
+                     [this, &chan](typename Channel_struc_t::Msg_in_ptr&& req)
+    {
+      on_struc_request(&chan, std::move(req));
+    });
+    for (auto& req : reqs)
+    {
+      on_struc_request(&chan, std::move(req));
+    }
+  }
+
+  void prep_zero_copy()
+  {
+    FLOW_LOG_INFO("= Prep: Deep-copying heap-backed capnp message into Flow-IPC SHM-backed message: START.");
+    typename Session::Structured_msg_builder_config::Builder
+      capnp_builder(m_session.session_shm_builder_config());
+    capnp_builder.payload_msg_builder()->setRoot(g_capnp_msg->getRoot<perf_demo::schema::Body>().asReader());
+    m_capnp_msg = typename Channel_struc::Msg_out(std::move(capnp_builder));
+    m_capnp_msg_prepped = true;
+    FLOW_LOG_INFO("= Prep: Deep-copying heap-backed capnp message into Flow-IPC SHM-backed message: DONE.");
+  }
+
+  void read_ctl()
+  {
+    /* Be careful to not start a recursion-loop (stack overflows-oh my) but rather an iteration-loop.  That is,
+     * if an async_X() yields would-block then return; if it yields error then explode; but if it yields success,
+     * then do *not* call our own function, or some function that would call our own function (that did the
+     * async_X()).  Rather, loop around to the next async_X(). */
+    do
+    {
+      m_chan_raw.async_receive_blob(Blob_mutable(&m_ctl, sizeof(m_ctl)), &m_err_code, &m_sz,
+                                    [this](const Error_code& err_code, size_t sz)
+      {
+        if (handle_ctl(err_code, sz))
+        {
+          read_ctl();
+        }
+      });
+      if (m_err_code == ipc::transport::error::Code::S_SYNC_IO_WOULD_BLOCK) { return; }
+    }
+    while (handle_ctl(m_err_code, m_sz));
+  }
+
+  // Returns `true` if and only if we should keep reading Ctl_msg commands.
+  bool handle_ctl(const Error_code& err_code, [[maybe_unused]] size_t sz)
+  {
+    if (err_code)
+    {
+      /* The client went away without S_END_SESSION (it crashed, was killed -- e.g., by run_multi_clients() after
+       * another client failed -- or it hit an error of its own); or at any rate our channel to it is no good.  That's
+       * its problem, not ours: the other sessions carry on.  So: treat it as S_END_SESSION.  (If it was the driving
+       * client, we'll not get S_END; the user can interrupt us.) */
+      FLOW_LOG_WARNING("Control channel to client is down ([" << err_code << "] [" << err_code.message() << "]); "
+                       "ending its session.");
+      m_on_done_func();
+      return false;
+    }
+    // else
+    assert((sz == sizeof(m_ctl)) && "Client should only send Ctl_msg commands over raw channel.");
+
+    switch (m_ctl.m_cmd)
+    {
+    case Ctl_msg::Cmd::S_PREP_CAPNP:
+      FLOW_LOG_INFO("= Got prep request (size [" << m_ctl.m_arg << "] bytes; 0 = keep current).");
+      m_small_mode = false;
+      if (m_ctl.m_arg != 0)
+      {
+        m_ctl.m_arg = prep_capnp_msg(get_logger(), m_ctl.m_arg);
+        prep_zero_copy();
+      }
+      else
+      {
+        // The zero-copy benchmark responds with SHM-backed copy of whatever main() (or a previous request) prepared.
+        if (!m_capnp_msg_prepped)
+        {
+          prep_zero_copy();
+        }
+        m_ctl.m_arg = data_sz();
+      }
+      FLOW_LOG_INFO("> Acknowledging prep request; data size = [" << m_ctl.m_arg << "] bytes.");
+      m_chan_raw.send_blob(Blob_const(&m_ctl, sizeof(m_ctl)));
+      return true;
+
+    case Ctl_msg::Cmd::S_GET_CACHE_RAW:
+      // It's once per timed iteration; let's not poison timing with that unless console logger turned up to TRACE+.
+      FLOW_LOG_TRACE("= Got get-cache request (raw).");
+      if constexpr(S_TRANSPORT == Transport::S_SOCKET)
+      {
+        send_capnp_over_raw(get_logger(), &m_chan_raw);
+      }
+      else
+      {
+        // Its large blobs would not fit into MQ messages; and the raw benchmark is about the socket anyway.
+        assert(false && "Client should send raw get-cache requests only in a socket-transport session.");
+      }
+      return true;
+
+    case Ctl_msg::Cmd::S_SMALL_MSGS:
+      FLOW_LOG_INFO("= Got small-message mode request (streaming batch size [" << m_ctl.m_arg << "]; "
+                    "0 = ping-pong).");
+      m_small_mode = true;
+      m_small_stream_n = m_ctl.m_arg;
+      m_small_stream_count = 0;
+      m_small_stream_ack = m_ctl;
+      FLOW_LOG_INFO("> Acknowledging small-message mode request.");
+      m_chan_raw.send_blob(Blob_const(&m_ctl, sizeof(m_ctl)));
+      return true;
+
+    case Ctl_msg::Cmd::S_BARRIER:
+      FLOW_LOG_INFO("= Got barrier request (group size [" << m_ctl.m_arg << "]).");
+      m_barrier.m_waiters.insert_or_assign(this, [this](const Ctl_msg& ctl)
+      {
+        m_chan_raw.send_blob(Blob_const(&ctl, sizeof(ctl)));
+      });
+      if (m_barrier.m_waiters.size() == m_ctl.m_arg)
+      {
+        FLOW_LOG_INFO("> All [" << m_ctl.m_arg << "] clients are at barrier; releasing them.");
+        for (const auto& waiter : m_barrier.m_waiters)
         {
-          data[byte_idx] = uint8_t(byte_idx % 256); // Dummy data... let's not just leave it as zeroes.
+          waiter.second(m_ctl);
         }
-        file_part.setDataSizeToVerify(FILE_PART_SZ);
-        /* Obviously a Boost string hash is not a cryptographically sound hash.  Fine for our purposes
-         * of sanity-checking that whatever the client received and accessed was at least mutually consistent nad
-         * not junk that accidentally didn't cause capnp to throw an exception during an accessor. */
-        file_part.setDataHashToVerify(boost::hash<String_view>()
-                                        (String_view(reinterpret_cast<const char*>(data.begin()), FILE_PART_SZ)));
+        m_barrier.m_waiters.clear();
       }
+      return true;
+
+    case Ctl_msg::Cmd::S_END_SESSION:
+      FLOW_LOG_INFO("= Client says its session is done.");
+      m_on_done_func();
+      return false;
+
+    case Ctl_msg::Cmd::S_END:
+      FLOW_LOG_INFO("= Client says it is done.");
+      g_asio.stop();
+      /* The .stop() is needed here, because struc::Channel is always reading all internally incoming messages ASAP;
+       * so it always has an .async_wait() outstanding.  Hence the .run() never runs out of work, unless we
+       * flip the g_asio internal "is-stopped" switch which causes it to in fact return the moment
+       * the .stop()ping task (function, such as this one) returns.  .stop() flips that switch. */
+      return false;
+    }
+
+    assert(false && "Unknown Ctl_msg command.");
+    return false;
+  } // handle_ctl()
+
+  template<typename Channel_struc_t>
+  void on_struc_request(Channel_struc_t* chan_ptr, typename Channel_struc_t::Msg_in_ptr&& req)
+  {
+    auto& chan = *chan_ptr;
+
+    if (!m_small_mode)
+    {
+      FLOW_LOG_TRACE("= Got get-cache request [" << *req << "].");
+      /* And now we do just the same thing as send_capnp_over_raw()... except over full-on Flow-IPC, with zero-copy!
+       * Obviously you'll see -- especially on the client side -- how much simpler it is.  And it'll be much, much,
+       * much faster for most sizes above, like, 10k: as the data are *never* copied. */
+      if constexpr(std::is_same_v<Channel_struc_t, Channel_struc>)
+      {
+        assert((chan_ptr == &m_chan_struc) && "Client should send capnp get-cache requests over session-SHM channel.");
+        assert(m_capnp_msg_prepped && "Client should send S_PREP_CAPNP before capnp get-cache requests.");
+        chan.send(m_capnp_msg, req.get());
+      }
+      else
+      {
+        assert(false && "Client should send capnp get-cache requests over session-SHM channel.");
+      }
+      return;
+    }
+    // else: Small-message mode.  No logging, not even TRACE: it'd be a significant chunk of what's being measured.
+
+    if (m_small_stream_n == 0)
+    {
+      /* Ping-pong.  Build a fresh response each time, as a real server would; so the per-message cost of that
+       * (including, for the SHM-backed channels, the SHM allocation) is part of what's measured. */
+      auto rsp = chan.create_msg();
+      auto file_part = rsp.body_root()->initGetCacheRsp().initFileParts(1)[0];
+      auto data = file_part.initData(S_SMALL_RSP_DATA_SZ);
+      std::fill(data.begin(), data.end(), uint8_t(0xAB)); // Dummy data... let's not just leave it as zeroes.
+      file_part.setDataSizeToVerify(S_SMALL_RSP_DATA_SZ);
+      chan.send(rsp, req.get());
+    }
+    else if (++m_small_stream_count == m_small_stream_n)
+    {
+      // Streaming: end of batch.  Tell the client (which is timing the batch) over the raw channel.
+      m_small_stream_count = 0;
+      m_chan_raw.send_blob(Blob_const(&m_small_stream_ack, sizeof(m_small_stream_ack)));
+    }
+  } // on_struc_request()
+
+  void on_stl_request(typename Channel_struc::Msg_in_ptr&& req)
+  {
+    using flow::Fine_clock;
+    using Kind = perf_demo::schema::GetStlReq::Kind;
+    using Stl = Shm_stl<Session, true>;
+
+    const auto start = Fine_clock::now();
+    const auto req_root = req->body_root().getGetStlReq();
+    const size_t n_elems = req_root.getNElems();
+    const auto arena = req_root.getAppElseSessionShm() ? m_session.app_shm() : m_session.session_shm();
+    // Once per timed iteration; so TRACE only (as with get-cache requests).
+    FLOW_LOG_TRACE("= Got STL request [" << *req << "].");
+
+    /* Fill it out as a real server would, element by element (but with a known total size, so a vector can reserve()
+     * it).  The values are arbitrary, as long as stl_checksum() will notice if the client somehow reads something
+     * else. */
+    switch (req_root.getKind())
+    {
+    case Kind::VECTOR:
+      send_stl<typename Stl::Vector>(arena, [n_elems](auto* vec)
+      {
+        vec->reserve(n_elems);
+        for (size_t idx = 0; idx != n_elems; ++idx)
+        {
+          vec->push_back(uint64_t(idx));
+        }
+      }, std::move(req), start);
+      return;
+    case Kind::MAP:
+      send_stl<typename Stl::Map>(arena, [n_elems](auto* map)
+      {
+        for (size_t idx = 0; idx != n_elems; ++idx)
+        {
+          map->emplace_hint(map->end(), uint64_t(idx), typename Stl::String(S_STL_MAP_VAL_SZ, char('a' + (idx % 26))));
+        }
+      }, std::move(req), start);
+      return;
+    case Kind::STRING:
+      send_stl<typename Stl::String>(arena, [n_elems](auto* str)
+      {
+        str->resize(n_elems);
+        for (size_t idx = 0; idx != n_elems; ++idx)
+        {
+          (*str)[idx] = char('a' + (idx % 26));
+        }
+      }, std::move(req), start);
+      return;
+    }
+    assert(false && "Unknown STL container kind.");
+  } // on_stl_request()
+
+  /* Builds a Container in *arena (construct<>() it, then `fill_func(Container*)`); lends it to the client; responds
+   * to `req` with the handle, our timings, and the checksum.  After that we drop our handle: the client's borrowed one
+   * keeps the thing alive until it's done with it. */
+  template<typename Container, typename Fill_func>
+  void send_stl(typename Session::Arena* arena, const Fill_func& fill_func, typename Channel_struc::Msg_in_ptr&& req,
+                flow::Fine_time_pt start)
+  {
+    using flow::Fine_clock;
+    using boost::chrono::nanoseconds;
+    using boost::chrono::round;
 
-      /* Note total_sz_mi is just a rough guide; we only count the GetCacheRsp.data field as "taking space";
-       * there's also nearby hash and size fields, plus capnp format overhead.  That said even with small
-       * sizes like 10kib it's a pretty decent estimate, it turns out.  (And it's certainly proportional at least.) */
+    const auto build_start = Fine_clock::now();
+    typename Session::Arena::template Handle<Container> container;
+    {
+      // Whatever the container allocates, it allocates in `arena`; that's what this is for.  (See Flow-IPC docs.)
+      ipc::shm::stl::Arena_activator<typename Session::Arena> arena_ctx(arena);
+      container = arena->template construct<Container>();
+      fill_func(container.get());
+    }
+    const auto lend_start = Fine_clock::now();
+    const auto lend_blob = m_session.lend_object(container);
+    const auto lend_end = Fine_clock::now();
+    if (lend_blob.empty())
+    {
+      // Per Flow-IPC docs: the session is hosed (client is gone?).  The Session will report it soon enough.
+      throw Runtime_error("STL benchmark: lend_object() failed.");
+    }
+
+    auto rsp = m_chan_struc.create_msg();
+    auto rsp_root = rsp.body_root()->initGetStlRsp();
+    auto handle_root = rsp_root.initHandle();
+    ipc::transport::struc::shm::capnp_set_lent_shm_handle(&handle_root, lend_blob);
+    rsp_root.setChecksum(stl_checksum(*container));
+    rsp_root.setBuildNanos(round<nanoseconds>(lend_start - build_start).count());
+    rsp_root.setLendNanos(round<nanoseconds>(lend_end - lend_start).count());
+    rsp_root.setServerNanos(round<nanoseconds>(Fine_clock::now() - start).count());
+    m_chan_struc.send(rsp, req.get());
+  } // send_stl()
+
+  size_t data_sz() const
+  {
+    const auto file_parts_list = g_capnp_msg->getRoot<perf_demo::schema::Body>().getGetCacheRsp().getFileParts();
+    return (file_parts_list.size() == 0) ? 0 : (file_parts_list.size() * file_parts_list[0].getData().size());
+  }
+}; // struct Serve_algo
+
+/* The server side of the raw (unstructured) async-I/O-vs-sync_io benchmarks: echoes back each blob received over
+ * a raw channel (see S_CHAN_ECHO).  Like Serve_algo it's driven by g_asio; but it does not care about Ctl_msg and
+ * such: it just keeps echoing until the channel goes down (e.g., client is done with the session). */
+template<typename Channel_raw_t>
+struct Echo_algo
+{
+  Channel_raw_t& m_chan;
+  std::array<uint8_t, S_ECHO_MSG_SZ> m_buf;
+  Error_code m_err_code;
+  size_t m_sz;
+
+  explicit Echo_algo(Channel_raw_t* chan_ptr) :
+    m_chan(*chan_ptr)
+  {
+    m_chan.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
+    m_chan.start_send_blob_ops(ev_wait);
+    m_chan.start_receive_blob_ops(ev_wait);
+    read_blobs();
+  }
+
+  void read_blobs()
+  {
+    // Same iteration-not-recursion deal as Serve_algo::read_ctl().
+    do
+    {
+      m_chan.async_receive_blob(Blob_mutable(m_buf.data(), m_buf.size()), &m_err_code, &m_sz,
+                                [this](const Error_code& err_code, size_t sz)
+      {
+        if (handle_blob(err_code, sz))
+        {
+          read_blobs();
+        }
+      });
+      if (m_err_code == ipc::transport::error::Code::S_SYNC_IO_WOULD_BLOCK) { return; }
+    }
+    while (handle_blob(m_err_code, m_sz));
+  }
 
-      FLOW_LOG_INFO("Prep: Filling capnp MallocMessageBuilder: DONE.");
+  // Returns `true` if and only if we should keep reading.
+  bool handle_blob(const Error_code& err_code, size_t sz)
+  {
+    if (err_code)
+    {
+      return false; // Client went away; or whatever it is, the session will report it; we don't care.
     }
+    m_chan.send_blob(Blob_const(m_buf.data(), sz));
+    return true;
+  }
+}; // struct Echo_algo
+
+/* Accepts sessions of transport S_TRANSPORT, keeping each (with its channels and Serve_algo) until its client is done
+ * with it; see serve().  A file-scope class template, as opposed to a local class in serve(), since serve() needs one
+ * per Transport. */
+template<Transport S_TRANSPORT>
+struct Accept_algo :
+  public flow::log::Log_context
+{
+  using Types = Transport_types<S_TRANSPORT>;
+  using Session_server = typename Types::Session_server;
+  using Session = typename Session_server::Server_session_obj;
+
+  // Init-channels to open: see Chan_idx.
+  static constexpr size_t S_N_INIT_CHANS = (S_TRANSPORT == Transport::S_SOCKET) ? S_N_CHANS : S_N_TRANSPORT_CHANS;
 
-    /* Accept one session.  Use the async-I/O API, as perf for this part really doesn't matter to anyone ever,
-     * and we're not timing it anyway, and it doesn't affect what happens after.  We don't start a thread; just
-     * use promise/future pattern to wait until Session_server is ready with success or failure. */
-    Session_server srv(&(*log_logger), SRV_APPS.find(SRV_NAME)->second, CLI_APPS);
-    FLOW_LOG_INFO("Session-server started.  You can now invoke session-client executable from same CWD; "
-                  "it will open session with some channel(s).");
-
-    Session session;
-    promise<Error_code> accepted_promise;
-    Session_server::Channels chans;
-    srv.async_accept(&session, &chans, nullptr, nullptr,
-                     [](auto&&...) -> size_t { return 2; }, // 2 init-channels to open.
-                     [](auto&&...) {},
-                     [&](const Error_code& err_code)
+  // A session, its channels, and its Serve_algo.  (Order matters: destroyed in reverse.)
+  struct Served_session
+  {
+    Session m_session;
+    typename Session_server::Channels m_chans;
+    std::optional<typename Types::Channel_struc> m_chan_struc;
+    std::optional<typename Types::Channel_struc_heap> m_chan_struc_heap;
+    std::optional<typename Types::Channel_struc> m_chan_struc_app;
+    std::optional<typename Types::Channel_struc> m_chan_struc_async;
+    std::optional<Echo_algo<typename Types::Channel_raw>> m_echo;
+    std::optional<Echo_algo<typename Types::Channel_raw>> m_echo_async;
+    std::optional<Serve_algo<S_TRANSPORT>> m_algo;
+  };
+
+  flow::log::Logger* const m_ipc_logger;
+  Load_barrier& m_barrier;
+  std::list<std::unique_ptr<Served_session>> m_sessions;
+  // Target of the outstanding async_accept().
+  std::unique_ptr<Served_session> m_accepting;
+  // Declared last, so it's destroyed first: that aborts the outstanding async_accept() targeting *m_accepting.
+  std::optional<Session_server> m_srv;
+
+  Accept_algo(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, Load_barrier* barrier_ptr) :
+    flow::log::Log_context(logger_ptr, flow::Flow_log_component::S_UNCAT),
+    m_ipc_logger(ipc_logger_ptr),
+    m_barrier(*barrier_ptr)
+  {
+    m_srv.emplace(m_ipc_logger, SRV_APPS.find(transport_srv_name(S_TRANSPORT))->second, CLI_APPS);
+    FLOW_LOG_INFO("Session-server for transport [" << transport_name(S_TRANSPORT) << "] started.");
+  }
+
+  void accept_next()
+  {
+    using boost::asio::post;
+
+    /* Use the async-I/O API, as perf for this part really doesn't matter to anyone ever, and we're not timing it
+     * anyway, and it doesn't affect what happens after.  Its handler runs in some Session_server-internal thread
+     * though; so get back onto ours via post(). */
+    m_accepting = std::make_unique<Served_session>();
+    m_srv->async_accept(&m_accepting->m_session, &m_accepting->m_chans, nullptr, nullptr,
+                        [](auto&&...) -> size_t { return S_N_INIT_CHANS; },
+                        [](auto&&...) {},
+                        [this](const Error_code& err_code)
     {
-      accepted_promise.set_value(err_code);
+      if (err_code == ipc::session::error::Code::S_OBJECT_SHUTDOWN_ABORTED_COMPLETION_HANDLER)
+      {
+        return; // We're shutting down.
+      }
+      post(g_asio, [this, err_code]() { on_accepted(err_code); });
     });
-    const auto err_code = accepted_promise.get_future().get();
+  }
+
+  void on_accepted(const Error_code& err_code)
+  {
     if (err_code)
     {
       throw Runtime_error(err_code, "totally unexpected error while accepting");
     }
     // else
-    FLOW_LOG_INFO("Session accepted: [" << session << "].");
+    m_sessions.push_back(std::move(m_accepting));
+    auto& ssn = *m_sessions.back();
+    FLOW_LOG_INFO("Session accepted: [" << ssn.m_session << "].");
 
     /* Ignore session errors (see disclaimer comment at top of for general justification).
      * Basically we know it'll be, if anything, just the client disconnecting from us when it's done; and by that
-     * point we'll be shutting down anyway.  And any transmission error will be detected along the channel of
-     * transmission.  As a not-serious-production-app, no need for this stuff. */
-    session.init_handlers([](auto&&...) {});
+     * point we'll be done with the session anyway.  And any transmission error will be detected along the channel
+     * of transmission.  As a not-serious-production-app, no need for this stuff. */
+    ssn.m_session.init_handlers([](auto&&...) {},
+                                /* Accept client-initiated channel opens too: the session-open benchmark times those.
+                                 * It has no use for the channel though; so just let it be destroyed.  (This runs in
+                                 * some session-internal thread; but touches nothing of ours, so that's fine.) */
+                                [](auto&&...) {});
     // Session in PEER state (opened fully); so channels are ready too.
 
-    /* For now there are just these two channels.  (See above where we specified `return 2`.)
+    /* For now there are just these channels.  (See above where we specified how many; and Chan_idx in common.hpp.)
      * You'll see in common.hpp that by setting a certain single type-alias, each channel is simply a
-     * local-stream-socket (a/k/a Unix domain socket) full-duplex connection.  (We could as of this writing instead
-     * set it to a POSIX MQ, or bipc MQ; it would be just a matter of changing that one alias.  We chose
-     * local-stream-socket, because it's a popular choice for people by default, and we'd like to run our
-     * no-Flow-IPC benchmark over that.)
+     * local-stream-socket (a/k/a Unix domain socket) full-duplex connection.  (Or, in the sessions of the
+     * transport-matrix benchmark, whichever Transport this Accept_algo is for: POSIX MQs, bipc MQs, either of those
+     * alongside a socket for native handles, or a socket that can also transmit native handles.  It's just a matter
+     * of the session type's template args.  We chose local-stream-socket as the main one, because it's a popular
+     * choice for people by default, and we'd like to run our no-Flow-IPC benchmark over that.)
+     *
+     * The S_CHAN_RAW one we'll just keep using in this raw form (no Flow-IPC transport::struc::Channel over it).
+     * Besides the no-Flow-IPC benchmark traffic it also carries the (tiny, untimed) Ctl_msg control messages
+     * with which the client drives the run.
      *
-     * This one we'll just keep using in this raw form (no Flow-IPC transport::struc::Channel over it). */
-    auto& chan_raw = chans[0];
+     * And this one we immediately upgrade to a Flow-IPC transport::struc::Channel. */
+    auto& chans = ssn.m_chans;
+    ssn.m_chan_struc.emplace(m_ipc_logger, std::move(chans[S_CHAN_STRUC_SESSION_SHM]), // Session-SHM-backed.
+                             ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM, &ssn.m_session);
+    if constexpr(S_N_INIT_CHANS == S_N_CHANS)
+    {
+      /* These two as well, but they're only used by the small-message benchmarks, which compare the per-message
+       * cost of the various serialization types: heap-backed (non-zero-copy) vs. session-SHM (above) vs. app-SHM. */
+      ssn.m_chan_struc_heap.emplace(m_ipc_logger, std::move(chans[S_CHAN_STRUC_HEAP]),
+                                    ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_HEAP,
+                                    ssn.m_session.session_token());
+      ssn.m_chan_struc_app.emplace(m_ipc_logger, std::move(chans[S_CHAN_STRUC_APP_SHM]),
+                                   ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_APP_SHM, &ssn.m_session);
+      // And these for the async-I/O-vs-sync_io benchmark.  (See Chan_idx.)
+      ssn.m_chan_struc_async.emplace(m_ipc_logger, std::move(chans[S_CHAN_STRUC_ASYNC]),
+                                     ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM,
+                                     &ssn.m_session);
+      ssn.m_echo.emplace(&chans[S_CHAN_ECHO]);
+      ssn.m_echo_async.emplace(&chans[S_CHAN_ECHO_ASYNC]);
+    }
 
-    // And this one we immediately upgrade to a Flow-IPC transport::struc::Channel.
-    Channel_struc chan_struc(&(*log_logger), std::move(chans[1]), // Structured channel: SHM-backed underneath.
-                             ipc::transport::struc::Channel_base::S_SERIALIZE_VIA_SESSION_SHM, &session);
+    ssn.m_algo.emplace(get_logger(), &chans[S_CHAN_RAW], &(*ssn.m_chan_struc),
+                       ssn.m_chan_struc_heap ? &(*ssn.m_chan_struc_heap) : nullptr,
+                       ssn.m_chan_struc_app ? &(*ssn.m_chan_struc_app) : nullptr,
+                       ssn.m_chan_struc_async ? &(*ssn.m_chan_struc_async) : nullptr,
+                       &ssn.m_session, &m_barrier,
+                       [this, ssn_ptr = &ssn]() { on_session_done(ssn_ptr); });
+    ssn.m_algo->start();
 
-    run_capnp_over_raw(&(*std_logger), &chan_raw); // Benchmark 1.  capnp data transmission without Flow-IPC zero-copy.
-    run_capnp_zero_copy(&(*std_logger), &chan_struc, &session); // Benchmark 2.  Same but with it.
+    accept_next();
+  } // on_accepted()
 
-    FLOW_LOG_INFO("Exiting.");
-  } // try
-  catch (const exception& exc)
+  void on_session_done(Served_session* ssn_ptr)
   {
-    FLOW_LOG_WARNING("Caught exception: [" << exc.what() << "].");
-    return 1;
+    /* If its client went away while at the barrier (see Serve_algo::handle_ctl()), take it off: else the release
+     * function would outlive its Serve_algo; and it would count toward the group. */
+    if (ssn_ptr->m_algo && (m_barrier.m_waiters.erase(&(*ssn_ptr->m_algo)) != 0))
+    {
+      FLOW_LOG_WARNING("Session ended while at multi-client barrier; taken off it.");
+    }
+    // We're called from inside its Serve_algo; so destroy it (and the rest) only once that returns.
+    boost::asio::post(g_asio, [this, ssn_ptr]()
+    {
+      m_sessions.remove_if([&](const auto& ssn) { return ssn.get() == ssn_ptr; });
+      FLOW_LOG_INFO("Session closed; [" << m_sessions.size() << "] remain.");
+    });
   }
+}; // struct Accept_algo
 
-  return 0;
-} // main()
+void serve(flow::log::Logger* logger_ptr, flow::log::Logger* ipc_logger_ptr, const Options& opts)
+{
+  using flow::Flow_log_component;
+  using boost::asio::post;
 
-void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
+
+  /* We accept any number of sessions, serving them all concurrently from this one thread (and event loop g_asio),
+   * as a typical server would.  Usually there's just the one session, with the client that drives the run; but
+   * multi-client benchmarks have it spawn a bunch of other clients, each with its session, which come and go; and
+   * the session-open and transport-matrix benchmarks have the client itself open more sessions.
+   *
+   * In each session we simply react to what the client asks for, on all channels.  That is:
+   *   - Over the raw channel come Ctl_msg commands.  One of them (S_GET_CACHE_RAW) is the get-cache request of
+   *     the no-Flow-IPC benchmark; we reply with g_capnp_msg's segments via send_capnp_over_raw().  Another
+   *     (S_PREP_CAPNP) asks us to (re-)prepare the response data (both copies) of a given size.  Another
+   *     (S_SMALL_MSGS) switches us to small-message mode (until the next S_PREP_CAPNP).  Another (S_BARRIER)
+   *     holds the client until all clients of a multi-client benchmark are ready to go.
+   *   - Over the session-SHM structured channel come GetCacheReq requests of the zero-copy benchmark; we reply with
+   *     the SHM-backed copy of g_capnp_msg.
+   *   - In small-message mode, over any of the structured channels come small GetCacheReq messages; we reply
+   *     to each with a small GetCacheRsp (ping-pong), or merely count them and report each completed batch
+   *     (streaming).  See Ctl_msg::Cmd::S_SMALL_MSGS.
+   *   - Over the echo channels (see Chan_idx) come blobs; we echo each one back (Echo_algo), whatever the mode.
+   *   - Over the session-SHM-backed structured channel may also come GetStlReqs, whatever the mode; we build the
+   *     requested STL container in SHM and lend it to the client (Serve_algo::on_stl_request()).
+   * A given client never has more than 1 benchmark going at a time, so there's no need to worry about interleaving
+   * within a session.  That goes on until the client says its session is done (S_END_SESSION); or that the whole
+   * thing is done (S_END) -- then we exit.
+   *
+   * Sessions of each Transport come in via a different Session_server; hence one Accept_algo per Transport.
+   * Each has its own server app (see SRV_APPS); so the client picks the transport by picking the server app. */
+  Load_barrier barrier;
+  Accept_algo<Transport::S_SOCKET> algo(logger_ptr, ipc_logger_ptr, &barrier);
+  Accept_algo<Transport::S_SOCKET_HNDL> algo_socket_hndl(logger_ptr, ipc_logger_ptr, &barrier);
+  Accept_algo<Transport::S_POSIX_MQ> algo_posix_mq(logger_ptr, ipc_logger_ptr, &barrier);
+  Accept_algo<Transport::S_POSIX_MQ_HNDL> algo_posix_mq_hndl(logger_ptr, ipc_logger_ptr, &barrier);
+  Accept_algo<Transport::S_BIPC_MQ> algo_bipc_mq(logger_ptr, ipc_logger_ptr, &barrier);
+  Accept_algo<Transport::S_BIPC_MQ_HNDL> algo_bipc_mq_hndl(logger_ptr, ipc_logger_ptr, &barrier);
+  static_assert(size_t(Transport::S_END_SENTINEL) == 6, "Add an Accept_algo for each Transport please.");
+  FLOW_LOG_INFO("Session-server started.  You can now invoke session-client executable from same CWD; "
+                "it will open session with some channel(s).");
+
+  post(g_asio, [&]()
+  {
+    algo.accept_next();
+    algo_socket_hndl.accept_next();
+    algo_posix_mq.accept_next();
+    algo_posix_mq_hndl.accept_next();
+    algo_bipc_mq.accept_next();
+    algo_bipc_mq_hndl.accept_next();
+  });
+  Spin_stats spin_stats;
+  run_event_loop(&g_asio, opts.m_spin_usec, &spin_stats);
+  g_asio.restart();
+  if (opts.m_spin_usec != 0)
+  {
+    FLOW_LOG_INFO("Event loop spun up to [" << opts.m_spin_usec << " usec] per wait: " << spin_stats << '.');
+  }
+  /* These next 2 lines aren't really important; technically it's true that when we issue .stop() that'll prevent
+   * any already-queued handlers from running once the .stop()ping task `return`s, so this issues an extra .poll()
+   * to "flush" those, if any... but not block after that's done. */
+  g_asio.poll();
+  g_asio.restart();
+} // serve()
+
+void send_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
 {
   using flow::Flow_log_component;
-  using flow::log::Logger;
-  using flow::log::Log_context;
   using flow::util::ceil_div;
   using ::capnp::word;
-  using boost::asio::post;
-  using std::vector;
+
+  FLOW_LOG_SET_CONTEXT(logger_ptr, Flow_log_component::S_UNCAT);
 
   /* While the code below is easy enough to follow, hopefully, we do need to explain why it's written like this at
-   * all.  So firstly see main() which summarizes the goal here; in short we prep some data to send to client;
+   * all.  So firstly see prep_capnp_msg() which summarizes the goal here; in short we prep some data to send to client;
    * inform client we're ready for it to start its timing run; client issues request; we receive it; we send the
    * large response; the client receives it; spits out RTT for the timing run; and verifies the data appears to
    * be fine.  Now specifically in *this* run:
    *   - "The data" is simply g_capnp_msg, a MallocMessageBuilder-backed (so, stored as N segments in heap, not SHM,
-   *     as arranged by capnp-supplied MallocMessageBuilder).  So it's already prepared back in main(): we needn't
-   *     do any more prep.
+   *     as arranged by capnp-supplied MallocMessageBuilder).  So it's already prepared by prep_capnp_msg(): we
+   *     needn't do any more prep.
    *   - The "send" and "receive" transport mechanism is a local stream socket (Unix domain socket), as prepared
    *     for us by main() in *chan_ptr.
    *
    * The idea is we're simulating what a "vanilla" impl would do here: one where we have a big heap-stored
    * capnp tree, and we want to transmit it via a stream-socket and read it on the other side.
-   * run_capnp_zero_copy() will do it with full-on-zero-copy Flow-IPC and show the difference in perf and (secondarily)
-   * ease of coding.  (The latter really is secondary; as with async-I/O API instead of sync_io the Flow-IPC-using
-   * code would've been *even* simpler.  But we want max available perf all around, so we'll do sync_io.  Do note
-   * async-I/O doesn't add much overhead... but some, from context switching and inter-thread signaling.)
+   * serve() (zero-copy path) will do it with full-on-zero-copy Flow-IPC and show the difference in perf and
+   * (secondarily) ease of coding.  (The latter really is secondary; as with async-I/O API instead of sync_io the
+   * Flow-IPC-using code would've been *even* simpler.  But we want max available perf all around, so we'll do
+   * sync_io.  Do note async-I/O doesn't add much overhead... but some, from context switching and inter-thread
+   * signaling.)
    *
    * There are a couple things to defend re. *how* we do that here, in terms of realism/appropriateness in this
    * perf_demo app.
@@ -301,195 +959,54 @@ void run_capnp_over_raw(flow::log::Logger* logger_ptr, Channel_raw* chan_ptr)
 
   // On to the code.
 
-  /* Local class just so we can arrange functions in chronological order really; it can be tough to do without
-   * this local-class trick, when working with boost.asio and similar (proactor pattern).  The different steps
-   * tend to get reversed in the code which is confusing, whereas this way it's top-down order. */
-  struct Algo :
-    public Log_context
-  {
-    Channel_raw& m_chan;
-    Error_code m_err_code;
-    size_t m_sz;
-    size_t m_n = 0;
-
-    Algo(Logger* logger_ptr, Channel_raw* chan_ptr) :
-      Log_context(logger_ptr, Flow_log_component::S_UNCAT),
-      m_chan(*chan_ptr)
-    {
-      FLOW_LOG_INFO("-- RUN - capnp request/response over raw local-socket connection --");
-    }
-
-    void start()
-    {
-      /* sync_io-pattern API: Drop-in our async-wait provider which is good ol' boost.asio .async_wait()
-       * over g_asio.  After this we can do sends and receives.  send()s in Flow-IPC are always synchronous,
-       * non-blocking, and never yield would-block.  Receives naturally are asynchronous; in sync_io pattern
-       * that means you give async_X() both a handler F to run later, if right now would-block results; and
-       * the out-args to set if the result is available synchronously right now.  So either one happens, or
-       * the other.  It's straightforward really, with one caveat to watch out for: avoid arbitrary-level
-       * recursive when reading looping data.  However here on server side we don't have any looping data
-       * to read (only send), so it's simple. */
-      m_chan.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
-      m_chan.start_send_blob_ops(ev_wait);
-      m_chan.start_receive_blob_ops(ev_wait);
-
-      /* Send a dummy message to synchronize initialization.
-       * It indicates we're for sure ready for this run to avoid any situation where, like,
-       * client sends get-cache-request, but we're still setting something up after accepting the session;
-       * so we only send the response once we're ready to do that; but client has already started timing. */
-      FLOW_LOG_INFO("> Issuing handshake SYN for initialization sync.");
-      m_chan.send_blob(Blob_const(&m_n, sizeof(m_n)));
-
-      /* Receive a dummy message as a request signal.  Technically we should expect an actual capnp-encoded
-       * (albeit small) GetCacheReq here; but we'll accept any message; in the big benchmark this detail does not
-       * matter.  No need for all the extra code on both sides. */
-      FLOW_LOG_INFO("< Expecting get-cache request via tiny message.");
-      m_chan.async_receive_blob(Blob_mutable(&m_n, sizeof(m_n)), &m_err_code, &m_sz,
-                                [&](const Error_code& err_code, size_t) { on_request(err_code); });
-      if (m_err_code != ipc::transport::error::Code::S_SYNC_IO_WOULD_BLOCK) { on_request(m_err_code); }
-    }
-
-    void on_request(const Error_code& err_code)
-    {
-      if (err_code) { throw Runtime_error(err_code, "run_capnp_over_raw():on_request()"); }
-      FLOW_LOG_INFO("= Got get-cache request.");
-
-      /* The format is like this:
-       *   - size_t - serialization's segment count
-       *   - [segment][segment]... where each [segment] is:
-       *     - size_t - segment size in bytes
-       *     - the segment: that many bytes
-       * BTW capnp's own format is not that different; but it has the seg-count, then the individual seg-sizes
-       * one after another, then the segments themselves one after another... plus the counts are 32-bits
-       * apparently.  @todo In retrospect the code on receiving side would've been somewhat simpler if we followed this
-       * header-then-segments technique... less state-switching back and forth arguably.  Live and learn!
-       *
-       * BTW you'll notice the characteristic escalation in segment sizes: by default MallocMessageBuilder
-       * will size each successive segment as equal to the sum of all preceding segment sizes... exponential growth. */
-
-      const auto capnp_segs = g_capnp_msg.getSegmentsForOutput();
-      m_n = capnp_segs.size();
-      FLOW_LOG_INFO("> Sending get-cache response fragment: capnp segment count = [" << m_n << "].");
-      m_chan.send_blob(Blob_const(&m_n, sizeof(m_n)));
-      FLOW_LOG_INFO("> Sending get-cache response fragments x N: [seg size, seg content...].");
-
-      /* Essentially (through Flow-IPC unstructured-transport layer) mostly do a bunch ~64k ::write()s.
-       * That's reasonably realistic.  (Technically Flow-IPC adds extra semantics on top; namely it preserves
-       * message boundaries; so send_blob() <=> async_receive_blob(), 1-to-1.  We use that just fine; and
-       * internally Flow-IPC will send a few more bytes in there, namely 2-byte message sizes, 1 per message; but
-       * it's minor in the big picture.  Real enough, I say!) */
-      const auto chunk_max_sz = m_chan.send_blob_max_size();
-      for (size_t idx = 0; idx != capnp_segs.size(); ++idx)
-      {
-        const auto capnp_seg = capnp_segs[idx].asBytes();
-        m_n = capnp_seg.size();
-        m_chan.send_blob(Blob_const(&m_n, sizeof(m_n)));
-
-        auto start = capnp_seg.begin();
-        do
-        {
-          const auto chunk_sz = std::min(chunk_max_sz, m_n);
-          m_chan.send_blob(Blob_const(start, chunk_sz));
-          start += chunk_sz;
-          m_n -= chunk_sz;
-        }
-        while (m_n != 0);
-        // It's e.g. 15 extra log lines; let's not poison timing with that unless console logger turned up to TRACE+.
-        FLOW_LOG_TRACE("= Sent segment [" << (idx + 1) << "] of [" << capnp_segs.size() << "]; "
-                       "segment serialization size (capnp-decided) = "
-                       "[" << ceil_div(capnp_seg.size(), size_t(1024)) << " Ki].");
-      }
-      FLOW_LOG_INFO("= Done.  Total allocated size = "
-                    "[" << ceil_div(g_capnp_msg.sizeInWords() * sizeof(word), size_t(1024 * 1024)) << " Mi].");
-    } // on_request()
-  }; // class Algo
-
-  Algo algo(logger_ptr, chan_ptr);
-  post(g_asio, [&]() { algo.start(); });
-  g_asio.run();
-  g_asio.restart();
-} // run_capnp_over_raw()
-
-void run_capnp_zero_copy(flow::log::Logger* logger_ptr, Channel_struc* chan_ptr, Session* session_ptr)
-{
-  using flow::Flow_log_component;
-  using flow::log::Logger;
-  using flow::log::Log_context;
-  using boost::asio::post;
-
-  /* And now we do just the same thing as run_capnp_over_raw()... except over full-on Flow-IPC, with zero-copy!
-   * Obviously you'll see -- especially on the client side -- how much simpler it is.  And it'll be much, much, much
-   * faster for most sizes above, like, 10k: as the data are *never* copied.
+  auto& chan = *chan_ptr;
+  size_t n;
+
+  /* The format is like this:
+   *   - size_t - serialization's segment count
+   *   - [segment][segment]... where each [segment] is:
+   *     - size_t - segment size in bytes
+   *     - the segment: that many bytes
+   * BTW capnp's own format is not that different; but it has the seg-count, then the individual seg-sizes
+   * one after another, then the segments themselves one after another... plus the counts are 32-bits
+   * apparently.  @todo In retrospect the code on receiving side would've been somewhat simpler if we followed this
+   * header-then-segments technique... less state-switching back and forth arguably.  Live and learn!
    *
-   * Keeping comments light, since it's the same thing but much simpler (unless there's a difference; then
-   * we comment away). */
-
-  struct Algo :
-    public Log_context
+   * BTW you'll notice the characteristic escalation in segment sizes: by default MallocMessageBuilder
+   * will size each successive segment as equal to the sum of all preceding segment sizes... exponential growth. */
+
+  const auto capnp_segs = g_capnp_msg->getSegmentsForOutput();
+  n = capnp_segs.size();
+  FLOW_LOG_TRACE("> Sending get-cache response fragment: capnp segment count = [" << n << "].");
+  chan.send_blob(Blob_const(&n, sizeof(n)));
+  FLOW_LOG_TRACE("> Sending get-cache response fragments x N: [seg size, seg content...].");
+
+  /* Essentially (through Flow-IPC unstructured-transport layer) mostly do a bunch ~64k ::write()s.
+   * That's reasonably realistic.  (Technically Flow-IPC adds extra semantics on top; namely it preserves
+   * message boundaries; so send_blob() <=> async_receive_blob(), 1-to-1.  We use that just fine; and
+   * internally Flow-IPC will send a few more bytes in there, namely 2-byte message sizes, 1 per message; but
+   * it's minor in the big picture.  Real enough, I say!) */
+  const auto chunk_max_sz = chan.send_blob_max_size();
+  for (size_t idx = 0; idx != capnp_segs.size(); ++idx)
   {
-    Channel_struc& m_chan;
-    Session::Structured_msg_builder_config::Builder m_capnp_builder;
-    Channel_struc::Msg_out m_capnp_msg;
-
-    Algo(Logger* logger_ptr, Channel_struc* chan_ptr, Session* session_ptr) :
-      Log_context(logger_ptr, Flow_log_component::S_UNCAT),
-      m_chan(*chan_ptr),
-      m_capnp_builder(session_ptr->session_shm_builder_config())
-    {
-      FLOW_LOG_INFO("-- RUN - zero-copy (SHM-backed) capnp request/response using Flow-IPC --");
-    }
+    const auto capnp_seg = capnp_segs[idx].asBytes();
+    n = capnp_seg.size();
+    chan.send_blob(Blob_const(&n, sizeof(n)));
 
-    void start()
+    auto start = capnp_seg.begin();
+    do
     {
-      FLOW_LOG_INFO("= Prep: Deep-copying heap-backed capnp message into Flow-IPC SHM-backed message: START.");
-      m_capnp_builder.payload_msg_builder()->setRoot(g_capnp_msg.getRoot<perf_demo::schema::Body>().asReader());
-      m_capnp_msg = Channel_struc::Msg_out(std::move(m_capnp_builder));
-      FLOW_LOG_INFO("= Prep: Deep-copying heap-backed capnp message into Flow-IPC SHM-backed message: DONE.");
-
-      m_chan.replace_event_wait_handles([]() -> auto { return Asio_handle(g_asio); });
-      m_chan.start_ops(ev_wait);
-      m_chan.start_and_poll([](const Error_code&) {});
-
-      // Send a dummy message to synchronize initialization.
-      FLOW_LOG_INFO("> Issuing handshake SYN for initialization sync.");
-      m_chan.send(m_chan.create_msg());
-
-      // Receive a dummy message as a request signal.
-      FLOW_LOG_INFO("< Expecting get-cache request.");
-      Channel_struc::Msg_in_ptr req;
-      m_chan.expect_msg(Channel_struc::Msg_which_in::GET_CACHE_REQ, &req,
-                        [&](Channel_struc::Msg_in_ptr&& req) { on_request(std::move(req)); });
-      if (req) { on_request(std::move(req)); }
+      const auto chunk_sz = std::min(chunk_max_sz, n);
+      chan.send_blob(Blob_const(start, chunk_sz));
+      start += chunk_sz;
+      n -= chunk_sz;
     }
-
-    void on_request(Channel_struc::Msg_in_ptr&& req)
-    {
-      /* Unlike run_capnp_over_raw(), where to avoid unnecessary code, we accepted any message as a request --
-       * here we require GetCacheReq specifically (hence the Msg_which_in::GET_CACHE_REQ arg value above).
-       * We don't check its contents, but we might as well print it.  If you're keeping score we're doing some
-       * stuff here that run_capnp_over_raw() entirely skips... but good enough for our purposes, we think;
-       * at least we're not skewing results in Flow-IPC's favor. */
-      FLOW_LOG_INFO("= Got get-cache request [" << *req << "].");
-
-      FLOW_LOG_INFO("> Sending get-cache (quite large) response.");
-      m_chan.send(m_capnp_msg, req.get());
-      FLOW_LOG_INFO("= Done.");
-      g_asio.stop();
-
-      /* The .stop() is needed here, because struc::Channel is always reading all internally incoming messages ASAP;
-       * so it always has an .async_wait() outstanding.  Hence the .run() never runs out of work, unless we
-       * flip the g_asio internal "is-stopped" switch which causes it to in fact return the moment
-       * the .stop()ping task (function, such as this one) returns.  .stop() flips that switch. */
-    } // on_request()
-  }; // class Algo
-
-  Algo algo(logger_ptr, chan_ptr, session_ptr);
-  post(g_asio, [&]() { algo.start(); });
-  g_asio.run();
-  g_asio.restart();
-  /* These next 2 lines aren't really important; technically it's true that when we issue .stop() that'll prevent
-   * any already-queued handlers from running once the .stop()ping task `return`s, so this issues an extra .poll()
-   * to "flush" those, if any... but not block after that's done. */
-  g_asio.poll();
-  g_asio.restart();
-} // run_capnp_zero_copy()
+    while (n != 0);
+    // It's e.g. 15 extra log lines; let's not poison timing with that unless console logger turned up to TRACE+.
+    FLOW_LOG_TRACE("= Sent segment [" << (idx + 1) << "] of [" << capnp_segs.size() << "]; "
+                   "segment serialization size (capnp-decided) = "
+                   "[" << ceil_div(capnp_seg.size(), size_t(1024)) << " Ki].");
+  }
+  FLOW_LOG_TRACE("= Done.  Total allocated size = "
+                 "[" << ceil_div(g_capnp_msg->sizeInWords() * sizeof(word), size_t(1024 * 1024)) << " Mi].");
+} // send_capnp_over_raw()
@@ -0,0 +1,97 @@
+/* Flow-IPC
+ * Copyright 2023 Akamai Technologies, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in
+ * compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the License is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing
+ * permissions and limitations under the License. */
+
+#include "results.hpp"
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cassert>
+
+static const std::string S_HEADER = "bench,config,metric,value";
+
+void write_results_csv(std::ostream& os, const Result_rows& rows)
+{
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  os << S_HEADER << '\n';
+  // Enough digits for a double to round-trip; so a comparison of identical runs yields exactly no change.
+  os << std::setprecision(std::numeric_limits<double>::max_digits10);
+  for (const auto& row : rows)
+  {
+    assert((row.m_bench.find(',') == std::string::npos) && (row.m_config.find(',') == std::string::npos)
+           && (row.m_metric.find(',') == std::string::npos) && "No commas in CSV fields please.");
+    os << row.m_bench << ',' << row.m_config << ',' << row.m_metric << ',' << row.m_value << '\n';
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
+
+bool read_results_csv(std::istream& is, Result_rows* rows, std::string* err_msg)
+{
+  using std::string;
+  using std::getline;
+
+  string line;
+  if ((!getline(is, line)) || (line != S_HEADER))
+  {
+    *err_msg = "Missing or unexpected header line (expected [" + S_HEADER + "]).";
+    return false;
+  }
+
+  for (size_t line_num = 2; getline(is, line); ++line_num)
+  {
+    if (line.empty())
+    {
+      continue;
+    }
+    // else
+
+    std::istringstream line_is(line);
+    Result_row row;
+    string value_str;
+    size_t pos = 0;
+    if (!(getline(line_is, row.m_bench, ',') && getline(line_is, row.m_config, ',')
+          && getline(line_is, row.m_metric, ',') && getline(line_is, value_str)))
+    {
+      *err_msg = "Line [" + std::to_string(line_num) + "]: expected 4 comma-separated fields.";
+      return false;
+    }
+    try
+    {
+      row.m_value = std::stod(value_str, &pos);
+    }
+    catch (const std::exception&)
+    {
+      pos = 0;
+    }
+    if ((pos == 0) || (pos != value_str.size()))
+    {
+      *err_msg = "Line [" + std::to_string(line_num) + "]: bad value [" + value_str + "].";
+      return false;
+    }
+    rows->push_back(std::move(row));
+  }
+
+  return true;
+} // read_results_csv()
+
+bool metric_higher_is_better(const std::string& metric)
+{
+  const std::string suffix = "_per_sec";
+  return (metric.size() >= suffix.size())
+         && (metric.compare(metric.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
@@ -0,0 +1,54 @@
+/* Flow-IPC
+ * Copyright 2023 Akamai Technologies, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in
+ * compliance with the License.  You may obtain a copy
+ * of the License at
+ *
+ *   https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the License is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing
+ * permissions and limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+/* Machine-readable benchmark results, as written by perf_demo_cli (`--results-file`) and read by
+ * perf_demo_compare (compare.cpp).  This bit deliberately depends on nothing but the standard library, so that the
+ * comparator need not link Flow or Flow-IPC.
+ *
+ * The format is CSV in "long" form: after the header line `bench,config,metric,value`, each line is one metric of one
+ * benchmark in one configuration; e.g.:
+ *   capnp_zero_copy,transport=local_stream_socket;shm=classic;serialization=session_shm;size=1048576,p50_usec,12.3
+ * `config` is `;`-separated `key=value` pairs.  Benchmark name plus config plus metric identify a value; so two
+ * result files can be matched up line by line regardless of order, and adding a new benchmark (or config key, or
+ * metric) doesn't change the format.  Metric names end in the unit; `*_per_sec` ones are higher-is-better,
+ * `n_samples` is informational, and the rest are lower-is-better.  No field may contain a comma (we never need
+ * one; so no quoting). */
+
+struct Result_row
+{
+  std::string m_bench;
+  std::string m_config;
+  std::string m_metric;
+  double m_value;
+};
+
+using Result_rows = std::vector<Result_row>;
+
+// Writes header line, then `rows` in order.
+void write_results_csv(std::ostream& os, const Result_rows& rows);
+/* Reads what write_results_csv() wrote, appending to *rows.  On format error returns `false` and sets *err_msg;
+ * *rows may then contain the rows preceding the bad one. */
+bool read_results_csv(std::istream& is, Result_rows* rows, std::string* err_msg);
+// `true` if and only if a greater value of the given metric is better (e.g., throughput); else lower is better.
+bool metric_higher_is_better(const std::string& metric);